@@ -0,0 +1,1077 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Host microbenchmark of the utilities
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * Each case runs a hot loop over one function of the utilities and reports
+ * the best of BENCH_REPEAT runs in nsec per operation, so that lower is
+ * better. The results are written to stdout in JSON:
+ *
+\verbatim
+{
+  "suite": "stm32utils",
+  "config": { "EVT_QDEPTH": 8, ... },
+  "results": [
+    { "name": "usrtimer.routine", "params": { "timers": 20 },
+      "value": 35.2, "unit": "ns/op", "iterations": 1000000 },
+    ...
+  ]
+}
+\endverbatim
+ *
+ * Usage: utils_bench [-n iterations] [-f filter]
+ *	- iterations: number of operations per run, 1000000 by default
+ *	- filter: run only the cases whose name starts with the string
+ *
+ * The flowctl entries are the result of a simulation of the serial flow
+ * control instead, in commands processed per 100 ticks (higher is better).
+ * The sampler.rate entries are the sample rates sustainable within the
+ * budgets of SMP_CPU and SMP_LINK (higher is better). The serialbatch.rate
+ * entries are the reports per second that fit in a link of BATCH_LINK,
+ * with and without batching (higher is better), for the report sizes of
+ * which two fit in MAX_PAYLOAD.
+ *
+ * The figures are for comparing builds on the same host, not for the
+ * target. The target runs the same loops roughly an order of magnitude
+ * slower.
+ */
+
+#define _GNU_SOURCE
+
+#include "UsrTimer.h"
+#include "EvtQueue.h"
+#include "EvtPool.h"
+#include "SerialComm.h"
+#include "SerialBatch.h"
+#include "PushButton.h"
+#include "PushButtonWide.h"
+#include "ActObj.h"
+#include "Coro.h"
+#include "Trace.h"
+#include "InputRec.h"
+#include "Prof.h"
+#include "Sampler.h"
+#include "HostStub.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// Number of runs of each case
+#define BENCH_REPEAT			5
+/// Default number of operations per run
+#define BENCH_ITERATIONS		1000000L
+
+/// Benchmark case: runs n operations with the parameter
+typedef void (* bench_func)(long n, long param);
+
+static struct
+{
+	long iterations;
+	const char *filter;
+	int count;					///< number of results written
+	volatile uint32_t sink;		///< keeps the results alive
+	uint8_t button;				///< PushButton_Read() value
+	pushbtnw_t wide;			///< PushButtonWide_Read() value
+} bench;
+
+static double Bench_Time(long n, long param, bench_func f);
+static void Bench_Result(const char *name, const char *params, double value,
+		const char *unit, long iterations);
+
+/** Monotonic time in nsec
+ */
+static double Bench_Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Run the case BENCH_REPEAT times and write the best result.
+ *
+ * \param name case name
+ * \param pname parameter name, NULL for none
+ * \param param parameter value
+ * \param f case function
+ */
+static void Bench_Case(const char *name, const char *pname, long param,
+		bench_func f)
+{
+	char params[64] = "";
+
+	if(bench.filter && strncmp(name, bench.filter, strlen(bench.filter)))
+	{
+		return;
+	}
+
+	if(pname)
+	{
+		snprintf(params, sizeof(params), " \"%s\": %ld ", pname, param);
+	}
+
+	Bench_Result(name, params, Bench_Time(bench.iterations, param, f),
+			"ns/op", bench.iterations);
+}
+
+/**
+ * Run the case function BENCH_REPEAT times after a warm up.
+ *
+ * \param  n number of operations per run
+ * \param  param parameter value
+ * \param  f case function
+ * \return best time in nsec per operation
+ */
+static double Bench_Time(long n, long param, bench_func f)
+{
+	double best = 0, t;
+	int i;
+
+	// warm up
+	f(n / 10 + 1, param);
+
+	for(i = 0; i < BENCH_REPEAT; i++)
+	{
+		t = Bench_Now();
+		f(n, param);
+		t = Bench_Now() - t;
+
+		if((i == 0) || (t < best))
+		{
+			best = t;
+		}
+	}
+
+	return best / n;
+}
+
+/**
+ * Write a result entry.
+ *
+ * \param name case name
+ * \param params members of the params object
+ * \param value result value
+ * \param unit unit of the value
+ * \param iterations number of operations or ticks per run
+ */
+static void Bench_Result(const char *name, const char *params, double value,
+		const char *unit, long iterations)
+{
+	printf("%s\n    { \"name\": \"%s\", \"params\": {%s}, \"value\": %.3f, "
+			"\"unit\": \"%s\", \"iterations\": %ld }", bench.count ? "," : "",
+			name, params, value, unit, iterations);
+
+	bench.count++;
+}
+
+/*---------------------------------------------------------------------------
+ * EvtQueue
+ */
+
+/** Enqueue and dequeue one event.
+ */
+static void Bench_EvtPair(long n, long param)
+{
+	uint8_t event[EVT_QWIDTH] = { EVT_PBTN_INPUT };
+	long i;
+
+	(void)param;
+
+	Evt_InitQueue();
+	for(i = 0; i < n; i++)
+	{
+		event[1] = (uint8_t)i;
+		Evt_EnQueue(event);
+		Evt_DeQueue(event);
+	}
+	bench.sink += event[1];
+}
+
+/** Fill the queue and drain it. The cost is per event.
+ */
+static void Bench_EvtBurst(long n, long param)
+{
+	uint8_t event[EVT_QWIDTH] = { EVT_PBTN_INPUT };
+	long i;
+	int k;
+
+	(void)param;
+
+	Evt_InitQueue();
+	for(i = 0; i < n; i += EVT_QDEPTH - 1)
+	{
+		for(k = 0; k < EVT_QDEPTH - 1; k++)
+		{
+			Evt_EnQueue(event);
+		}
+		while(Evt_DeQueue(event))
+		{
+			bench.sink++;
+		}
+	}
+}
+
+/** Allocate a block, retain and release it twice.
+ */
+static void Bench_PoolCycle(long n, long param)
+{
+	uint8_t handle;
+	long i;
+
+	(void)param;
+
+	EvtPool_Init();
+	for(i = 0; i < n; i++)
+	{
+		handle = EvtPool_Alloc();
+		EvtPool_Retain(handle);
+		EvtPool_Release(handle);
+		EvtPool_Release(handle);
+	}
+	bench.sink += EvtPool_Free();
+}
+
+/*---------------------------------------------------------------------------
+ * UsrTimer
+ */
+
+static void Bench_TimerCallback(void)
+{
+	bench.sink++;
+}
+
+/** UsrTimer_Routine() with param timers that do not expire during the run,
+ * so that the cost is the scan of the timers by itself.
+ */
+static void Bench_TimerRoutine(long n, long param)
+{
+	long i;
+
+	UsrTimer_Init();
+	for(i = 0; i < param; i++)
+	{
+		UsrTimer_Set(n + 1, 0, Bench_TimerCallback);
+	}
+
+	for(i = 0; i < n; i++)
+	{
+		UsrTimer_Routine();
+	}
+
+	UsrTimer_Init();
+}
+
+/** UsrTimer_Routine() firing a timer of period 1 at every tick, found after
+ * param timers that do not expire.
+ */
+static void Bench_TimerFire(long n, long param)
+{
+	long i;
+
+	UsrTimer_Init();
+	for(i = 0; i < param; i++)
+	{
+		UsrTimer_Set(n + 1, 0, Bench_TimerCallback);
+	}
+	UsrTimer_Set(1, 0, Bench_TimerCallback);
+
+	for(i = 0; i < n; i++)
+	{
+		UsrTimer_Routine();
+	}
+
+	UsrTimer_Init();
+}
+
+/*---------------------------------------------------------------------------
+ * SerialComm
+ */
+
+/** Decode a stream of packets of param payload bytes. The cost is per byte.
+ */
+static void Bench_Decoder(long n, long param)
+{
+	uint8_t stream[MAX_PKTSIZE];
+	uint8_t packet[MAX_PKTSIZE];
+	uint8_t csum = 0;
+	int size = (int)param + 3;
+	long i;
+	int k;
+
+	stream[0] = PKT_HEADR;
+	stream[1] = (uint8_t)param;
+	for(k = 0; k < param; k++)
+	{
+		stream[2 + k] = (uint8_t)(k * 7);
+		csum ^= stream[2 + k];
+	}
+	stream[2 + param] = csum;
+
+	for(i = 0, k = 0; i < n; i++)
+	{
+		if(PKT_RECEIVED == SerialComm_Decoder(stream[k], packet))
+		{
+			bench.sink++;
+		}
+		if(++k == size)
+		{
+			k = 0;
+		}
+	}
+}
+
+/** Same as above, assembling the packet in place by SerialComm_Decode().
+ */
+static void Bench_Decode(long n, long param)
+{
+	uint8_t stream[MAX_PKTSIZE];
+	uint8_t packet[MAX_PKTSIZE];
+	pkt_decoder dec;
+	uint8_t csum = 0;
+	int size = (int)param + 3;
+	long i;
+	int k;
+
+	stream[0] = PKT_HEADR;
+	stream[1] = (uint8_t)param;
+	for(k = 0; k < param; k++)
+	{
+		stream[2 + k] = (uint8_t)(k * 7);
+		csum ^= stream[2 + k];
+	}
+	stream[2 + param] = csum;
+
+	SerialComm_InitDecoder(&dec, packet);
+	for(i = 0, k = 0; i < n; i++)
+	{
+		if(PKT_RECEIVED == SerialComm_Decode(&dec, stream[k]))
+		{
+			bench.sink++;
+		}
+		if(++k == size)
+		{
+			k = 0;
+		}
+	}
+}
+
+/** Build and send a packet of MAX_PAYLOAD bytes.
+ */
+static void Bench_SendPacket(long n, long param)
+{
+	uint8_t payload[MAX_PAYLOAD] = { 0 };
+	long i;
+
+	(void)param;
+
+	for(i = 0; i < n; i++)
+	{
+		payload[0] = (uint8_t)i;
+		SerialComm_SendPacket(payload, MAX_PAYLOAD);
+	}
+}
+
+/** Add 3-byte reports to the batch. The frame is sent when full.
+ */
+static void Bench_BatchAdd(long n, long param)
+{
+	uint8_t report[3] = { 1, 2, 3 };
+	long i;
+
+	(void)param;
+
+	SerialBatch_Init();
+	for(i = 0; i < n; i++)
+	{
+		report[0] = (uint8_t)i;
+		SerialBatch_Add(report, sizeof(report));
+	}
+	SerialBatch_Flush();
+}
+
+/*---------------------------------------------------------------------------
+ * Batching throughput
+ *
+ * The same stream of reports is sent once by SerialComm_SendPacket(), a
+ * packet per report, and once by SerialBatch_Add(). The bytes on the link
+ * per report give the report rate at a fixed baud rate.
+ */
+
+/// Link capacity in bytes per second: 115200 baud
+#define BATCH_LINK				11520.0
+/// Number of reports of a run
+#define BATCH_REPORTS			10000
+
+/** Send BATCH_REPORTS reports of size bytes, batched or not.
+ *
+ * \return link bytes per report
+ */
+static double Bench_BatchRun(int size, bool batched)
+{
+	uint8_t report[MAX_PAYLOAD] = { 0 };
+	uint32_t bytes = HostStub_TxBytes();
+	long i;
+
+	UsrTimer_Init();
+	SerialBatch_Init();
+	for(i = 0; i < BATCH_REPORTS; i++)
+	{
+		report[0] = (uint8_t)i;
+		if(batched)
+		{
+			SerialBatch_Add(report, size);
+		}
+		else
+		{
+			SerialComm_SendPacket(report, size);
+		}
+	}
+	SerialBatch_Flush();
+	UsrTimer_Init();
+
+	return (double)(HostStub_TxBytes() - bytes) / BATCH_REPORTS;
+}
+
+/** Reports per second with and without batching, for each report size of
+ * which two fit in a frame.
+ */
+static void Bench_BatchRate(void)
+{
+	static const int sizes[] = { 1, 2, 3, 5, 8 };
+	char params[64];
+	unsigned i;
+	int size, batched;
+
+	if(bench.filter && strncmp("serialbatch.rate", bench.filter,
+			strlen(bench.filter)))
+	{
+		return;
+	}
+
+	for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		size = sizes[i];
+		if(2 * (size + 1) + 1 > MAX_PAYLOAD)
+		{
+			break;
+		}
+
+		for(batched = 0; batched < 2; batched++)
+		{
+			snprintf(params, sizeof(params),
+					" \"report\": %d, \"batched\": %d, \"baud\": %d ", size,
+					batched, (int)(BATCH_LINK * 10));
+			Bench_Result("serialbatch.rate", params,
+					BATCH_LINK / Bench_BatchRun(size, batched), "report/s",
+					BATCH_REPORTS);
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------
+ * PushButton
+ */
+
+uint8_t PushButton_Read(void)
+{
+	return bench.button;
+}
+
+pushbtnw_t PushButtonWide_Read(void)
+{
+	return bench.wide;
+}
+
+static bool Bench_Sink(uint8_t *event)
+{
+	bench.sink += event[2];
+	return true;
+}
+
+/** One scan of PushButton_Routine(). param 0: no button pressed, 1: all
+ * buttons clicking at different rates.
+ */
+static void Bench_PushButton(long n, long param)
+{
+	long i;
+
+	UsrTimer_Init();
+	PushButton_Init(0xff);
+	PushButton_Stop();
+	PushButton_SetSink(Bench_Sink);
+
+	bench.button = 0;
+	for(i = 0; i < n; i++)
+	{
+		if(param)
+		{
+			// button k toggles every k + 1 scans
+			bench.button = 0;
+			for(int k = 0; k < 8; k++)
+			{
+				bench.button |= (((i / (k + 1)) & 1) << k);
+			}
+		}
+		PushButton_Routine();
+	}
+
+	PushButton_SetSink(NULL);
+	UsrTimer_Init();
+}
+
+/** One scan of PushButtonWide_Routine(), same patterns as above.
+ */
+static void Bench_PushButtonWide(long n, long param)
+{
+	long i;
+
+	UsrTimer_Init();
+	PushButtonWide_Init(~(pushbtnw_t)0);
+	PushButtonWide_SetSink(Bench_Sink);
+
+	bench.wide = 0;
+	for(i = 0; i < n; i++)
+	{
+		if(param)
+		{
+			bench.wide = 0;
+			for(int k = 0; k < PUSHBTNW_WIDTH; k++)
+			{
+				bench.wide |= (pushbtnw_t)((i / (k % 8 + 1)) & 1) << k;
+			}
+		}
+		PushButtonWide_Routine();
+	}
+
+	PushButtonWide_SetSink(NULL);
+	UsrTimer_Init();
+}
+
+/*---------------------------------------------------------------------------
+ * ActObj and Coro
+ */
+
+static void Bench_Handler(uint8_t *event)
+{
+	bench.sink += event[1];
+}
+
+/** Post an event to each of param active objects, then run them until
+ * idle. The cost is per event.
+ */
+static void Bench_ActObj(long n, long param)
+{
+	static uint8_t buff[ACT_MAX_OBJ][4][EVT_QWIDTH];
+	static actobj ao[ACT_MAX_OBJ];
+	uint8_t event[EVT_QWIDTH] = { 0x80 };
+	long i;
+	int k;
+
+	ActObj_Init();
+	for(k = 0; k < param; k++)
+	{
+		ActObj_Start(&ao[k], k, buff[k], 4, Bench_Handler);
+	}
+
+	for(i = 0; i < n; i += param)
+	{
+		event[1] = (uint8_t)i;
+		for(k = 0; k < param; k++)
+		{
+			ActObj_Post(&ao[k], event);
+		}
+		while(ActObj_Run());
+	}
+	ActObj_Init();
+}
+
+static void Bench_CoroYield(coro_task *t)
+{
+	CORO_BEGIN(t);
+	while(1)
+	{
+		bench.sink++;
+		CORO_YIELD(t);
+	}
+	CORO_END(t);
+}
+
+static void Bench_CoroSleep(coro_task *t)
+{
+	CORO_BEGIN(t);
+	while(1)
+	{
+		CORO_AWAIT_TICKS(t, 1000000);
+	}
+	CORO_END(t);
+}
+
+/** Coro_Run() with CORO_MAX_TASK tasks. param 0: all waiting, 1: all
+ * yielding.
+ */
+static void Bench_Coro(long n, long param)
+{
+	static coro_task task[CORO_MAX_TASK];
+	long i;
+
+	Coro_Init();
+	for(i = 0; i < CORO_MAX_TASK; i++)
+	{
+		Coro_Start(&task[i], param ? Bench_CoroYield : Bench_CoroSleep);
+	}
+	for(i = 0; i < n; i++)
+	{
+		Coro_Run();
+	}
+	Coro_Init();
+}
+
+/*---------------------------------------------------------------------------
+ * Trace, InputRec and Prof
+ */
+
+/** Write a trace record.
+ */
+static void Bench_Trace(long n, long param)
+{
+	long i;
+
+	(void)param;
+
+	Trace_Init();
+	for(i = 0; i < n; i++)
+	{
+		Trace_Record(TRC_USER, (uint8_t)i, 0);
+	}
+}
+
+/** Write an input record. The buffer is restarted when full.
+ */
+static void Bench_InputRec(long n, long param)
+{
+	long i;
+
+	(void)param;
+
+	InputRec_Start();
+	for(i = 0; i < n; i++)
+	{
+		if(InputRec_Overflow())
+		{
+			InputRec_Start();
+		}
+		InputRec_Record(REC_SERIAL, (uint8_t)i);
+	}
+	InputRec_Stop();
+}
+
+/** Take a profiler sample from param distinct program counters.
+ */
+static void Bench_Prof(long n, long param)
+{
+	long i;
+
+	Prof_Init();
+	for(i = 0; i < n; i++)
+	{
+		Prof_Sample(0x08000100 + (uint32_t)(i % param) * 6);
+	}
+	Prof_Stop();
+}
+
+/*---------------------------------------------------------------------------
+ * Flow control simulation
+ *
+ * A sender streams 3-byte commands over a link of SIM_LINK bytes per tick
+ * to a receiver that puts each packet in the event queue and answers ACK
+ * or NAK. A NAKed command is sent again. The receiver has SIM_BUDGET work
+ * units per tick. A received byte takes the unit it arrives in, as the
+ * UART interrupt would, and an event takes SIM_COST of the other units.
+ * The sender starts a packet only when the last one is out, and takes
+ * the replies at the next byte time. Both ends run the same SerialComm
+ * module; the side variable routes their output.
+ */
+
+/// Number of ticks simulated
+#define SIM_TICKS				20000
+/// Link capacity in bytes per tick
+#define SIM_LINK				60
+/// Work units of the receiver per tick
+#define SIM_BUDGET				100
+/// Work units to process an event
+#define SIM_COST				10
+/// Commands waiting in the sender
+#define SIM_BACKLOG				64
+/// Watermarks of the receiver queue
+#define SIM_HIGH				(EVT_QDEPTH - 3)
+#define SIM_LOW					2
+
+static struct
+{
+	bool receiver;				///< the receiver is sending
+	uint8_t link[MAX_PKTSIZE];	///< packet on the way to the receiver
+	int link_size;
+	uint8_t back[16];			///< replies on the way to the sender
+	int back_size;
+} sim;
+
+/** Route the bytes sent by SerialComm to the side's link.
+ */
+static void Bench_SimTx(uint8_t *buffer, int size)
+{
+	int i;
+
+	for(i = 0; i < size; i++)
+	{
+		if(sim.receiver && (sim.back_size < (int)sizeof(sim.back)))
+		{
+			sim.back[sim.back_size++] = buffer[i];
+		}
+		else if(!sim.receiver && (sim.link_size < (int)sizeof(sim.link)))
+		{
+			sim.link[sim.link_size++] = buffer[i];
+		}
+	}
+}
+
+/**
+ * Run the simulation at the offered load.
+ *
+ * \param  load offered commands per 100 ticks
+ * \param  flowctl true to tie XOFF / XON to the queue watermarks
+ * \return commands processed per 100 ticks
+ */
+static double Bench_SimRun(long load, bool flowctl)
+{
+	uint8_t spacket[MAX_PKTSIZE], rpacket[MAX_PKTSIZE];
+	uint8_t payload[3] = { 0x01, 0x02, 0x03 };
+	uint8_t event[EVT_QWIDTH] = { EVT_PBTN_INPUT };
+	pkt_decoder sdec, rdec;
+	long offered = 0, backlog = 0, processed = 0;
+	int unit, bytes, work = 0, i;
+	uint32_t t;
+
+	SerialComm_InitDecoder(&sdec, spacket);
+	SerialComm_InitDecoder(&rdec, rpacket);
+	HostStub_SetTxHook(Bench_SimTx);
+	sim.link_size = sim.back_size = 0;
+
+	// clear the flow control state of both sides
+	HostStub_SetTick(0);
+	SerialComm_Decode(&sdec, PKT_XON);
+	sim.receiver = true;
+	SerialComm_SetBusy(false);
+	sim.back_size = 0;
+
+	Evt_InitQueue();
+	Evt_SetWatermark(SIM_HIGH, SIM_LOW, flowctl ? SerialComm_SetBusy : NULL);
+
+	for(t = 0; t < SIM_TICKS; t++)
+	{
+		HostStub_SetTick(t);
+
+		// sender: new commands, dropped if the backlog is full
+		offered += load;
+		for(; offered >= 100; offered -= 100)
+		{
+			backlog += (backlog < SIM_BACKLOG);
+		}
+
+		for(unit = 0, bytes = 0; unit < SIM_BUDGET; unit++)
+		{
+			// byte time of the link
+			if(bytes < (unit + 1) * SIM_LINK / SIM_BUDGET)
+			{
+				bytes++;
+
+				// sender: replies so far, a NAKed command goes back
+				sim.receiver = false;
+				for(i = 0; i < sim.back_size; i++)
+				{
+					if(NAK_RECEIVED == SerialComm_Decode(&sdec, sim.back[i]))
+					{
+						backlog++;
+					}
+				}
+				sim.back_size = 0;
+
+				// sender: next packet once the last one is out
+				if((sim.link_size == 0) && (backlog > 0) &&
+						SerialComm_SendPacket(payload, sizeof(payload)))
+				{
+					backlog--;
+				}
+
+				// receiver: the byte takes this unit
+				if(sim.link_size > 0)
+				{
+					sim.receiver = true;
+					if(PKT_RECEIVED == SerialComm_Decode(&rdec, sim.link[0]))
+					{
+						SerialComm_Reply(!SerialComm_Busy() &&
+								Evt_EnQueue(event));
+					}
+					memmove(sim.link, sim.link + 1, --sim.link_size);
+					continue;
+				}
+			}
+
+			// receiver: event processing
+			sim.receiver = true;
+			if(Evt_Count() == 0)
+			{
+				work = 0;
+			}
+			else if((++work >= SIM_COST) && Evt_DeQueue(event))
+			{
+				processed++;
+				work = 0;
+			}
+		}
+	}
+
+	Evt_SetWatermark(0, 0, NULL);
+	sim.receiver = false;
+	SerialComm_Decode(&sdec, PKT_XON);
+	sim.receiver = true;
+	SerialComm_SetBusy(false);
+	HostStub_SetTxHook(NULL);
+	HostStub_SetTick(0);
+
+	return processed * 100.0 / SIM_TICKS;
+}
+
+/** Goodput against the offered load with and without flow control.
+ */
+static void Bench_FlowCtl(void)
+{
+	char params[64];
+	long load;
+	int fc;
+
+	if(bench.filter && strncmp("flowctl", bench.filter, strlen(bench.filter)))
+	{
+		return;
+	}
+
+	for(fc = 0; fc < 2; fc++)
+	{
+		for(load = 200; load <= 1200; load += 200)
+		{
+			snprintf(params, sizeof(params),
+					" \"offered\": %ld, \"flowctl\": %d ", load, fc);
+			Bench_Result("flowctl.goodput", params, Bench_SimRun(load, fc),
+					"cmd/100tick", SIM_TICKS);
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------
+ * Sampling pipeline
+ *
+ * Each sample is either sent in its own packet, as a UsrTimer callback
+ * calling SerialComm_SendPacket() would, or goes through Sampler_Push() and
+ * Sampler_Send() in one of the modes below. The signal is a slow ramp with
+ * a few counts of noise, as from an ADC. The CPU cost per sample is
+ * measured on the host and the link cost is the bytes sent per sample.
+ */
+
+/// CPU budget of the sampling in nsec per second: 10% of the host
+#define SMP_CPU					1e8
+/// Link budget in bytes per second: 115200 baud
+#define SMP_LINK				11520.0
+/// Length of the signal
+#define SMP_SIGNAL				4096
+
+static const struct
+{
+	const char *name;
+	uint8_t decim;				///< 0 for a packet per sample
+	uint8_t mode;
+} smp_modes[] =
+{
+	{ "packet", 0, 0 },
+	{ "raw", 1, SAMPLER_RAW },
+	{ "delta", 1, SAMPLER_DELTA },
+	{ "delta", 4, SAMPLER_DELTA },
+	{ "stats", 1, SAMPLER_STATS | SAMPLER_NODATA },
+};
+
+static struct
+{
+	int16_t signal[SMP_SIGNAL];
+	uint8_t event[EVT_QWIDTH];	///< block event posted by the sampler
+	bool ready;
+} smp;
+
+/** Block event sink standing for the event queue
+ */
+static bool Bench_SmpSink(uint8_t *event)
+{
+	memcpy(smp.event, event, EVT_QWIDTH);
+	smp.ready = true;
+
+	return true;
+}
+
+/** Take n samples of the signal in the mode of index param.
+ */
+static void Bench_SmpRun(long n, long param)
+{
+	uint8_t payload[2];
+	int16_t value;
+	long i;
+
+	Sampler_Init(smp_modes[param].decim, smp_modes[param].mode);
+	Sampler_SetSink(Bench_SmpSink);
+	smp.ready = false;
+
+	for(i = 0; i < n; i++)
+	{
+		value = smp.signal[i % SMP_SIGNAL];
+
+		// a packet per sample
+		if(smp_modes[param].decim == 0)
+		{
+			payload[0] = (uint8_t)(value >> 8);
+			payload[1] = (uint8_t)value;
+			SerialComm_SendPacket(payload, sizeof(payload));
+			continue;
+		}
+
+		Sampler_Push(value);
+		// main loop
+		if(smp.ready)
+		{
+			smp.ready = false;
+			Sampler_Send(smp.event);
+		}
+	}
+
+	bench.sink += Sampler_Lost();
+}
+
+/** Sustainable sample rate of each mode within the CPU and link budgets.
+ */
+static void Bench_Sampler(void)
+{
+	char params[64];
+	double cpu, link;
+	uint32_t bytes;
+	unsigned i;
+
+	if(bench.filter && strncmp("sampler", bench.filter, strlen(bench.filter)))
+	{
+		return;
+	}
+
+	// ramp of 1/8 count per sample with +-7 counts of noise
+	for(i = 0; i < SMP_SIGNAL; i++)
+	{
+		smp.signal[i] = (int16_t)(1024 + i / 8 + (int)((i * 2654435761u) >> 28)
+				- 7);
+	}
+
+	for(i = 0; i < sizeof(smp_modes) / sizeof(smp_modes[0]); i++)
+	{
+		snprintf(params, sizeof(params), " \"mode\": \"%s\", \"decim\": %d ",
+				smp_modes[i].name, smp_modes[i].decim);
+
+		bytes = HostStub_TxBytes();
+		Bench_SmpRun(bench.iterations, i);
+		link = (double)(HostStub_TxBytes() - bytes) / bench.iterations;
+		cpu = Bench_Time(bench.iterations, i, Bench_SmpRun);
+
+		Bench_Result("sampler.bytes", params, link, "B/sample",
+				bench.iterations);
+		Bench_Result("sampler.cpu", params, cpu, "ns/sample",
+				bench.iterations);
+		Bench_Result("sampler.rate", params,
+				(SMP_CPU / cpu < SMP_LINK / link) ? SMP_CPU / cpu
+					: SMP_LINK / link, "sample/s", bench.iterations);
+	}
+
+	Sampler_Init(1, SAMPLER_RAW);
+}
+
+int main(int argc, char *argv[])
+{
+	static const long timers[] = { 0, 1, 5, 10, MAX_USRTIMER };
+	unsigned i;
+
+	bench.iterations = BENCH_ITERATIONS;
+	for(i = 1; i + 1 < (unsigned)argc; i += 2)
+	{
+		if(!strcmp(argv[i], "-n"))
+		{
+			bench.iterations = atol(argv[i + 1]);
+		}
+		else if(!strcmp(argv[i], "-f"))
+		{
+			bench.filter = argv[i + 1];
+		}
+	}
+	if(bench.iterations < 1)
+	{
+		bench.iterations = 1;
+	}
+
+	printf("{\n  \"suite\": \"stm32utils\",\n");
+	printf("  \"config\": { \"EVT_QDEPTH\": %d, \"EVT_QWIDTH\": %d, "
+			"\"MAX_USRTIMER\": %d, \"MAX_PAYLOAD\": %d, "
+			"\"PUSHBTNW_WIDTH\": %d },\n",
+			EVT_QDEPTH, EVT_QWIDTH, MAX_USRTIMER, MAX_PAYLOAD, PUSHBTNW_WIDTH);
+	printf("  \"results\": [");
+
+	Bench_Case("evtqueue.pair", NULL, 0, Bench_EvtPair);
+	Bench_Case("evtqueue.burst", NULL, 0, Bench_EvtBurst);
+	Bench_Case("evtpool.cycle", NULL, 0, Bench_PoolCycle);
+
+	for(i = 0; i < sizeof(timers) / sizeof(timers[0]); i++)
+	{
+		Bench_Case("usrtimer.routine", "timers", timers[i], Bench_TimerRoutine);
+	}
+	for(i = 0; i < sizeof(timers) / sizeof(timers[0]); i++)
+	{
+		if(timers[i] < MAX_USRTIMER)
+		{
+			Bench_Case("usrtimer.fire", "timers", timers[i], Bench_TimerFire);
+		}
+	}
+
+	Bench_Case("serialcomm.decoder", "payload", 1, Bench_Decoder);
+	Bench_Case("serialcomm.decoder", "payload", MAX_PAYLOAD, Bench_Decoder);
+	Bench_Case("serialcomm.decode", "payload", MAX_PAYLOAD, Bench_Decode);
+	Bench_Case("serialcomm.sendpacket", "payload", MAX_PAYLOAD,
+			Bench_SendPacket);
+	Bench_Case("serialbatch.add", "report", 3, Bench_BatchAdd);
+	Bench_BatchRate();
+
+	Bench_Case("pushbutton.routine", "active", 0, Bench_PushButton);
+	Bench_Case("pushbutton.routine", "active", 1, Bench_PushButton);
+	Bench_Case("pushbuttonwide.routine", "active", 0, Bench_PushButtonWide);
+	Bench_Case("pushbuttonwide.routine", "active", 1, Bench_PushButtonWide);
+
+	Bench_Case("actobj.post_run", "objects", 1, Bench_ActObj);
+	Bench_Case("actobj.post_run", "objects", 4, Bench_ActObj);
+	Bench_Case("actobj.post_run", "objects", ACT_MAX_OBJ, Bench_ActObj);
+	Bench_Case("coro.run", "ready", 0, Bench_Coro);
+	Bench_Case("coro.run", "ready", 1, Bench_Coro);
+
+	Bench_Case("trace.record", NULL, 0, Bench_Trace);
+	Bench_Case("inputrec.record", NULL, 0, Bench_InputRec);
+	Bench_Case("prof.sample", "pcs", 16, Bench_Prof);
+	Bench_Case("prof.sample", "pcs", PROF_BUCKETS / 2, Bench_Prof);
+
+	Bench_FlowCtl();
+	Bench_Sampler();
+
+	printf("\n  ]\n}\n");
+
+	return 0;
+}
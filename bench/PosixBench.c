@@ -0,0 +1,285 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Benchmark of the POSIX port
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * Unlike utils_bench, which drives UsrTimer_Routine() by itself, this
+ * program runs the utilities on the timer thread of the POSIX port
+ * (posix/Inc/PosixPort.h) in real time, and writes the results to stdout
+ * in the same JSON form:
+ *	- posix.timer.*: interval between the calls of a UsrTimer callback of
+ *	  period 1, and its deviation from the tick, in usec
+ *	- posix.evt.*: events posted by a UsrTimer callback, in bursts of
+ *	  "burst" events per tick, and taken by the main thread sleeping in
+ *	  PosixPort_Wait(). The rate is in events per second, the latency from
+ *	  the post to the dequeue in usec, and the events refused by the full
+ *	  queue are counted as lost.
+ *
+ * Usage: utils_posix_bench [-n ticks] [-u tick_usec]
+ *	- ticks: number of ticks per case, 2000 by default
+ *	- tick_usec: tick of the timer thread, 1000 by default
+ *
+ * The figures depend on the load and the scheduler of the host. Run on an
+ * idle machine and compare the runs on the same host only.
+ */
+
+#define _GNU_SOURCE
+
+#include "UsrTimer.h"
+#include "EvtQueue.h"
+#include "PosixPort.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// Default number of ticks per case
+#define PBENCH_TICKS			2000
+/// Default tick in usec
+#define PBENCH_TICK_USEC		1000
+/// Event code of the benchmark
+#define PBENCH_EVT				0x80
+
+static struct
+{
+	long ticks;
+	uint32_t tick_usec;
+	int count;					///< number of results written
+	double *stamp;				///< time of each callback or post in usec
+	volatile long calls;		///< number of callbacks so far
+	int burst;					///< events posted per callback
+	volatile long posted;
+	volatile long lost;
+} pb;
+
+/** Monotonic time in usec
+ */
+static double PBench_Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+/**
+ * Write a result entry.
+ *
+ * \param name case name
+ * \param params members of the params object
+ * \param value result value
+ * \param unit unit of the value
+ */
+static void PBench_Result(const char *name, const char *params, double value,
+		const char *unit)
+{
+	printf("%s\n    { \"name\": \"%s\", \"params\": {%s}, \"value\": %.3f, "
+			"\"unit\": \"%s\", \"iterations\": %ld }", pb.count ? "," : "",
+			name, params, value, unit, pb.ticks);
+
+	pb.count++;
+}
+
+static int PBench_Compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/** Value at the fraction p of the sorted array
+ */
+static double PBench_Percentile(double *v, long n, double p)
+{
+	qsort(v, n, sizeof(double), PBench_Compare);
+
+	return v[(long)(p * (n - 1))];
+}
+
+/*---------------------------------------------------------------------------
+ * Timer jitter
+ */
+
+/** Timer callback: time stamp of the call
+ */
+static void PBench_Tick(void)
+{
+	if(pb.calls < pb.ticks)
+	{
+		pb.stamp[pb.calls] = PBench_Now();
+	}
+	pb.calls++;
+}
+
+/** Intervals of a UsrTimer of period 1 on the timer thread.
+ */
+static void PBench_Timer(void)
+{
+	double *dev = malloc(pb.ticks * sizeof(double));
+	double sum = 0, sq = 0, d;
+	long i, n = pb.ticks - 1;
+
+	pb.calls = 0;
+	UsrTimer_Init();
+	PosixPort_Init(pb.tick_usec);
+	HAL_SuspendTick();
+	UsrTimer_Set(1, 0, PBench_Tick);
+	HAL_ResumeTick();
+
+	while(pb.calls < pb.ticks)
+	{
+		PosixPort_Wait(100);
+	}
+	PosixPort_Exit();
+
+	for(i = 0; i < n; i++)
+	{
+		d = pb.stamp[i + 1] - pb.stamp[i];
+		sum += d;
+		sq += d * d;
+		dev[i] = fabs(d - pb.tick_usec);
+	}
+
+	PBench_Result("posix.timer.interval", "", sum / n, "us");
+	PBench_Result("posix.timer.jitter", " \"stat\": \"stddev\" ",
+			sqrt(sq / n - (sum / n) * (sum / n)), "us");
+	PBench_Result("posix.timer.jitter", " \"stat\": \"p99\" ",
+			PBench_Percentile(dev, n, 0.99), "us");
+	PBench_Result("posix.timer.jitter", " \"stat\": \"max\" ",
+			PBench_Percentile(dev, n, 1.0), "us");
+
+	free(dev);
+}
+
+/*---------------------------------------------------------------------------
+ * Event throughput
+ */
+
+/** Timer callback: a burst of events carrying the sequence number
+ */
+static void PBench_Post(void)
+{
+	uint8_t event[EVT_QWIDTH] = { PBENCH_EVT };
+	long seq;
+	int i;
+
+	if(pb.calls >= pb.ticks)
+	{
+		return;
+	}
+
+	for(i = 0; i < pb.burst; i++)
+	{
+		seq = pb.posted + pb.lost;
+		memcpy(&event[1], &seq, sizeof(seq));
+		pb.stamp[seq] = PBench_Now();
+		if(Evt_EnQueue(event))
+		{
+			pb.posted++;
+		}
+		else
+		{
+			pb.lost++;
+		}
+	}
+
+	// counted after the burst, so that the main thread waits for it
+	pb.calls++;
+}
+
+/** Events from the timer thread to the main thread.
+ */
+static void PBench_Events(int burst)
+{
+	uint8_t event[EVT_QWIDTH];
+	char params[64];
+	double *lat = malloc(pb.ticks * burst * sizeof(double));
+	double t, sum = 0;
+	long seq, taken = 0;
+
+	pb.calls = 0;
+	pb.burst = burst;
+	pb.posted = pb.lost = 0;
+	free(pb.stamp);
+	pb.stamp = malloc(pb.ticks * burst * sizeof(double));
+
+	UsrTimer_Init();
+	Evt_InitQueue();
+	PosixPort_Init(pb.tick_usec);
+	t = PBench_Now();
+	HAL_SuspendTick();
+	UsrTimer_Set(1, 0, PBench_Post);
+	HAL_ResumeTick();
+
+	while((pb.calls < pb.ticks) || (taken < pb.posted))
+	{
+		PosixPort_Wait(100);
+		while(Evt_DeQueue(event))
+		{
+			memcpy(&seq, &event[1], sizeof(seq));
+			lat[taken] = PBench_Now() - pb.stamp[seq];
+			sum += lat[taken++];
+		}
+	}
+	t = PBench_Now() - t;
+	PosixPort_Exit();
+
+	snprintf(params, sizeof(params), " \"burst\": %d ", burst);
+	PBench_Result("posix.evt.rate", params, taken * 1e6 / t, "event/s");
+	PBench_Result("posix.evt.latency", params, taken ? sum / taken : 0, "us");
+	snprintf(params, sizeof(params), " \"burst\": %d, \"stat\": \"p99\" ",
+			burst);
+	PBench_Result("posix.evt.latency", params,
+			taken ? PBench_Percentile(lat, taken, 0.99) : 0, "us");
+	snprintf(params, sizeof(params), " \"burst\": %d ", burst);
+	PBench_Result("posix.evt.lost", params, pb.lost, "event");
+
+	free(lat);
+}
+
+int main(int argc, char *argv[])
+{
+	int i;
+
+	pb.ticks = PBENCH_TICKS;
+	pb.tick_usec = PBENCH_TICK_USEC;
+	for(i = 1; i + 1 < argc; i += 2)
+	{
+		if(!strcmp(argv[i], "-n"))
+		{
+			pb.ticks = atol(argv[i + 1]);
+		}
+		else if(!strcmp(argv[i], "-u"))
+		{
+			pb.tick_usec = (uint32_t)atol(argv[i + 1]);
+		}
+	}
+	if(pb.ticks < 2)
+	{
+		pb.ticks = 2;
+	}
+	if(pb.tick_usec < 1)
+	{
+		pb.tick_usec = 1;
+	}
+
+	printf("{\n  \"suite\": \"stm32utils.posix\",\n");
+	printf("  \"config\": { \"EVT_QDEPTH\": %d, \"EVT_QWIDTH\": %d, "
+			"\"tick_usec\": %u },\n", EVT_QDEPTH, EVT_QWIDTH, pb.tick_usec);
+	printf("  \"results\": [");
+
+	pb.stamp = malloc(pb.ticks * sizeof(double));
+	PBench_Timer();
+
+	PBench_Events(1);
+	PBench_Events(EVT_QDEPTH - 1);
+	free(pb.stamp);
+
+	printf("\n  ]\n}\n");
+
+	return 0;
+}
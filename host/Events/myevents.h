@@ -0,0 +1,26 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Event codes for the host build
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * Each project defines its own event codes in myevents.h. This file is used
+ * only when the utilities are built on the host by themselves. Set the
+ * UTILS_EVENTS_DIR cache variable of CMake to use the one of a project.
+ */
+
+#ifndef __MY_EVENTS_H
+#define __MY_EVENTS_H
+
+/// Event codes
+#define EVT_PBTN_INPUT			0x01	///< push button gesture
+
+/// PushButton event types
+#define PBTN_SCLK				0x01	///< single click
+#define PBTN_DCLK				0x02	///< double click
+#define PBTN_TCLK				0x03	///< triple click
+#define PBTN_LCLK				0x04	///< long click
+#define PBTN_DOWN				0x05	///< button down
+#define PBTN_ENDN				0x06	///< button up
+
+#endif // __MY_EVENTS_H
@@ -0,0 +1,38 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Platform stubs for the host build
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * This program provides the platform functions that the utilities expect,
+ * without any thread or device, so that a single-threaded program such as
+ * the benchmark drives UsrTimer_Routine() by itself:
+ *	- HAL_SuspendTick() / HAL_ResumeTick() do nothing
+ *	- HAL_GetTick() returns the value set by HostStub_SetTick()
+ *	- SerialComm_SendByte() / SerialComm_SendByteArray() count the bytes and
+ *	  pass them to the hook set by HostStub_SetTxHook()
+ *
+ * Use the POSIX port (posix/Inc/PosixPort.h) instead to run in real time.
+ */
+
+#ifndef __HOST_STUB_H
+#define __HOST_STUB_H
+
+#include <stdint.h>
+
+/// Receiver of the bytes sent by SerialComm
+typedef void (* hoststub_txhook)(uint8_t *buffer, int size);
+
+/// Set the value returned by HAL_GetTick()
+void HostStub_SetTick(uint32_t tick);
+/// Set the receiver of the bytes sent, NULL to discard
+void HostStub_SetTxHook(hoststub_txhook hook);
+/// Number of bytes sent by SerialComm
+uint32_t HostStub_TxBytes(void);
+
+/// HAL functions provided by the stubs
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+uint32_t HAL_GetTick(void);
+
+#endif // __HOST_STUB_H
@@ -0,0 +1,77 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "HostStub.h"
+#include "SerialComm.h"
+
+static struct
+{
+	uint32_t tick;
+	uint32_t tx_bytes;
+	hoststub_txhook hook;
+} stub;
+
+/**
+ * \param tick value returned by HAL_GetTick()
+ */
+void HostStub_SetTick(uint32_t tick)
+{
+	stub.tick = tick;
+}
+
+/**
+ * \param hook function that receives the bytes sent, NULL to discard them
+ */
+void HostStub_SetTxHook(hoststub_txhook hook)
+{
+	stub.hook = hook;
+}
+
+/**
+ * \return number of bytes sent by SerialComm so far
+ */
+uint32_t HostStub_TxBytes(void)
+{
+	return stub.tx_bytes;
+}
+
+/** No interrupt to hold off on the host.
+ */
+void HAL_SuspendTick(void)
+{
+}
+
+/** No interrupt to hold off on the host.
+ */
+void HAL_ResumeTick(void)
+{
+}
+
+/** Tick value set by HostStub_SetTick()
+ */
+uint32_t HAL_GetTick(void)
+{
+	return stub.tick;
+}
+
+/** Count the byte and pass it to the hook.
+ */
+void SerialComm_SendByte(uint8_t byte)
+{
+	SerialComm_SendByteArray(&byte, 1);
+}
+
+/** Count the bytes and pass them to the hook.
+ */
+void SerialComm_SendByteArray(uint8_t *buffer, int size)
+{
+	stub.tx_bytes += size;
+
+	if(stub.hook)
+	{
+		stub.hook(buffer, size);
+	}
+}
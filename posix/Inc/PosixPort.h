@@ -0,0 +1,95 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	POSIX runtime for the utilities
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * This program provides the platform functions that the utilities expect
+ * from the STM32 HAL and the application, so that the same sources run in
+ * a Linux process:
+ *	- a thread driven by timerfd calls UsrTimer_Routine() at each tick
+ *	- HAL_SuspendTick() / HAL_ResumeTick(), UsrTimer_Enable() and IrqLock
+ *	  lock out the timer thread with a recursive mutex, thus they can be
+ *	  called from the timer callbacks as well
+ *	- HAL_GetTick() returns msec since PosixPort_Init()
+ *	- SerialComm_SendByte() / SerialComm_SendByteArray() write to a tty or
+ *	  pty opened by PosixPort_OpenSerial()
+ *	- Evt_Signal() writes to an eventfd so that the consumer can sleep in
+ *	  PosixPort_Wait() instead of polling Evt_DeQueue()
+ *
+ * PosixPort_Profile() drives the profiler (stm32/Inc/Prof.h) from a SIGPROF
+ * timer, as the tick interrupt does on the target.
+ *
+ * PosixPort_Wait() also watches the serial port with epoll and calls
+ * SerialComm_RxRoutine() when data is available, where the application
+ * reads the bytes by PosixPort_ReadSerial() and feeds them to the decoder,
+ * as it would do in the UART interrupt on the target.
+ *
+\code
+void SerialComm_RxRoutine(void)
+{
+	uint8_t bytes[64];
+	int i, n;
+
+	n = PosixPort_ReadSerial(bytes, sizeof(bytes));
+	for(i = 0; i < n; i++)
+	{
+		if(PKT_RECEIVED == SerialComm_Decoder(bytes[i], packet))
+		...
+	}
+}
+
+int main()
+{
+	UsrTimer_Init();
+	Evt_InitQueue();
+	PosixPort_Init(1000);
+	PosixPort_OpenSerial("/dev/ttyUSB0", 115200);
+
+	while(1)
+	{
+		PosixPort_Wait(-1);
+		while(Evt_DeQueue(event))
+		{
+			...
+		}
+	}
+}
+\endcode
+ *
+ * As on the target, Evt_EnQueue() is not protected. An event posted from
+ * the main thread should be done between HAL_SuspendTick() and
+ * HAL_ResumeTick() if the timer callbacks post events too.
+ */
+
+#ifndef __POSIX_PORT_H
+#define __POSIX_PORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// PosixPort_Wait() return bits
+#define POSIX_WAIT_EVENT		0x01	///< new event is posted
+#define POSIX_WAIT_SERIAL		0x02	///< serial data was processed
+
+/// Start the timer thread
+bool PosixPort_Init(uint32_t tick_usec);
+/// Stop the timer thread and release the resources
+void PosixPort_Exit(void);
+/// Open a tty or a pty for SerialComm
+bool PosixPort_OpenSerial(const char *path, uint32_t baud);
+/// Use an already opened file descriptor for SerialComm
+void PosixPort_SetSerialFd(int fd);
+/// Read available bytes from the serial port
+int PosixPort_ReadSerial(uint8_t *buffer, int size);
+/// Wait for an event or serial data
+int PosixPort_Wait(int timeout_ms);
+/// Start or stop the SIGPROF timer driving Prof_Sample()
+bool PosixPort_Profile(uint32_t usec);
+
+/// HAL functions provided by the port
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+uint32_t HAL_GetTick(void);
+
+#endif // __POSIX_PORT_H
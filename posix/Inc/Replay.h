@@ -0,0 +1,72 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Replay of the inputs recorded by InputRec
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * This program feeds a session recorded by InputRec (stm32/Inc/InputRec.h)
+ * back through UsrTimer_Routine(), PushButton_Routine(), SerialComm_Decoder()
+ * and the event queue on a simulated clock. There is no timer thread; each
+ * recorded tick calls UsrTimer_Routine() directly, thus the replay is
+ * deterministic and runs as fast as the host can.
+ *
+ * The driver provides PushButton_Read() that returns the recorded button
+ * state. The new state is taken at the same tick where the target read it.
+ * The events are retrieved by Evt_DeQueue() at the points where the target
+ * retrieved them, and are passed to the handler where the application logic
+ * of the main loop goes. The decoded packets are passed to the packet
+ * handler in the same way.
+ *
+ * PushButton_Routine() should run from the UsrTimer, as it does by default,
+ * so that each button read falls on a recorded tick.
+ *
+ * The system must be initialized in the same way as the target was when
+ * InputRec_Start() was called. Build the replay without INPUTREC_ENABLE and
+ * link it with the HAL functions of the POSIX port or any other stubs, but
+ * do not start the timer thread.
+ *
+\code
+void OnEvent(uint8_t *event)
+{
+	// main loop event handling of the application
+}
+
+int main()
+{
+	static uint8_t log[16384];
+	replay_handler h = { OnEvent, NULL };
+	int size;
+
+	// serial capture containing the dump packets
+	size = Replay_Extract(capture, capture_size, log, sizeof(log));
+
+	UsrTimer_Init();
+	Evt_InitQueue();
+	PushButton_Init(0x03);
+
+	Replay_Run(log, size, &h);
+}
+\endcode
+ */
+
+#ifndef __REPLAY_H
+#define __REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Callbacks of the replay
+typedef struct
+{
+	void (*event)(uint8_t *event);		///< event retrieved
+	void (*packet)(uint8_t *packet);	///< packet decoded
+} replay_handler;
+
+/// Collect the records from a serial capture of InputRec_Dump()
+int Replay_Extract(const uint8_t *capture, int size, uint8_t *log, int max);
+/// Feed the records to the utilities
+bool Replay_Run(const uint8_t *log, int size, const replay_handler *h);
+/// Number of ticks replayed
+uint32_t Replay_Ticks(void);
+
+#endif // __REPLAY_H
@@ -0,0 +1,513 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#define _GNU_SOURCE
+
+#include "PosixPort.h"
+#include "UsrTimer.h"
+#include "EvtQueue.h"
+#include "SerialComm.h"
+#include "Prof.h"
+#include "IrqLock.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
+#include <sys/timerfd.h>
+
+extern volatile bool usrtimer_enable;
+
+static struct
+{
+	pthread_mutex_t lock;		///< held while UsrTimer_Routine() runs
+	pthread_t thread;
+	volatile bool running;
+	int timer_fd;
+	int event_fd;
+	int epoll_fd;
+	int serial_fd;
+	struct timespec start;
+	uintptr_t base;				///< load address of the executable
+	uintptr_t low, high;		///< address range of the executable code
+} port = { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP, 0, false, -1, -1, -1, -1,
+	{0, 0}, 0, 0, 0 };
+
+static void *PosixPort_TimerThread(void *arg);
+static int PosixPort_FindCode(struct dl_phdr_info *info, size_t size,
+		void *data);
+static void PosixPort_ProfHandler(int sig, siginfo_t *info, void *context);
+
+/**
+ * Create the eventfd and the epoll instance, then start the timer thread
+ * that calls UsrTimer_Routine() every tick_usec.
+ *
+ * \param  tick_usec base tick of the UsrTimer in usec
+ * \return false if any of the resources cannot be created
+ */
+bool PosixPort_Init(uint32_t tick_usec)
+{
+	struct itimerspec its;
+	struct epoll_event ev;
+
+	clock_gettime(CLOCK_MONOTONIC, &port.start);
+
+	port.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	port.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	port.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if((port.event_fd < 0) || (port.epoll_fd < 0) || (port.timer_fd < 0))
+	{
+		PosixPort_Exit();
+		return false;
+	}
+
+	// watch the eventfd
+	ev.events = EPOLLIN;
+	ev.data.fd = port.event_fd;
+	epoll_ctl(port.epoll_fd, EPOLL_CTL_ADD, port.event_fd, &ev);
+
+	// periodic timer
+	its.it_interval.tv_sec = tick_usec / 1000000;
+	its.it_interval.tv_nsec = (tick_usec % 1000000) * 1000;
+	its.it_value = its.it_interval;
+	if(timerfd_settime(port.timer_fd, 0, &its, NULL) < 0)
+	{
+		PosixPort_Exit();
+		return false;
+	}
+
+	port.running = true;
+	if(pthread_create(&port.thread, NULL, PosixPort_TimerThread, NULL) != 0)
+	{
+		port.running = false;
+		PosixPort_Exit();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Stop the timer thread and close all the file descriptors including the
+ * serial port.
+ */
+void PosixPort_Exit(void)
+{
+	if(port.running)
+	{
+		port.running = false;
+		pthread_join(port.thread, NULL);
+	}
+
+	if(port.timer_fd >= 0)
+	{
+		close(port.timer_fd);
+	}
+	if(port.event_fd >= 0)
+	{
+		close(port.event_fd);
+	}
+	if(port.epoll_fd >= 0)
+	{
+		close(port.epoll_fd);
+	}
+	if(port.serial_fd >= 0)
+	{
+		close(port.serial_fd);
+	}
+
+	port.timer_fd = port.event_fd = port.epoll_fd = port.serial_fd = -1;
+}
+
+/**
+ * Open the tty device in raw mode. A pty can be used as well, in which case
+ * the baud rate is ignored. Should be called after PosixPort_Init().
+ *
+ * \param  path device path such as /dev/ttyUSB0
+ * \param  baud baud rate
+ * \return false if the device cannot be opened
+ */
+bool PosixPort_OpenSerial(const char *path, uint32_t baud)
+{
+	struct termios tio;
+	speed_t speed;
+	int fd;
+
+	fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if(fd < 0)
+	{
+		return false;
+	}
+
+	switch(baud)
+	{
+		case 9600:		speed = B9600;		break;
+		case 19200:		speed = B19200;		break;
+		case 38400:		speed = B38400;		break;
+		case 57600:		speed = B57600;		break;
+		case 230400:	speed = B230400;	break;
+		case 460800:	speed = B460800;	break;
+		case 921600:	speed = B921600;	break;
+		default:		speed = B115200;	break;
+	}
+
+	// raw mode
+	if(tcgetattr(fd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, speed);
+		cfsetospeed(&tio, speed);
+		tio.c_cflag |= CLOCAL | CREAD;
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+
+	PosixPort_SetSerialFd(fd);
+
+	return true;
+}
+
+/**
+ * Use the file descriptor for SerialComm, e.g. one end of a socketpair or
+ * a pty master. The descriptor should be in non-blocking mode.
+ *
+ * \param fd file descriptor
+ */
+void PosixPort_SetSerialFd(int fd)
+{
+	struct epoll_event ev;
+
+	if(port.serial_fd >= 0)
+	{
+		epoll_ctl(port.epoll_fd, EPOLL_CTL_DEL, port.serial_fd, NULL);
+		close(port.serial_fd);
+	}
+
+	port.serial_fd = fd;
+
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	epoll_ctl(port.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/**
+ * Read the bytes available in the serial port without blocking.
+ *
+ * \param  buffer storage for the bytes
+ * \param  size size of the buffer
+ * \return number of bytes read
+ */
+int PosixPort_ReadSerial(uint8_t *buffer, int size)
+{
+	ssize_t n;
+
+	if(port.serial_fd < 0)
+	{
+		return 0;
+	}
+
+	n = read(port.serial_fd, buffer, size);
+
+	return (n > 0) ? (int)n : 0;
+}
+
+/**
+ * Sleep until an event is posted or serial data arrives. When the serial
+ * data arrives, SerialComm_RxRoutine() is called if defined.
+ *
+ * \param  timeout_ms timeout in msec, -1 to wait forever
+ * \return POSIX_WAIT_EVENT and/or POSIX_WAIT_SERIAL, 0 on timeout
+ */
+int PosixPort_Wait(int timeout_ms)
+{
+	struct epoll_event ev[2];
+	uint64_t count;
+	int flag = 0;
+	int i, n;
+
+	n = epoll_wait(port.epoll_fd, ev, 2, timeout_ms);
+
+	for(i = 0; i < n; i++)
+	{
+		// clear the event counter
+		if(ev[i].data.fd == port.event_fd)
+		{
+			if(read(port.event_fd, &count, sizeof(count)) > 0)
+			{
+				flag |= POSIX_WAIT_EVENT;
+			}
+		}
+		// serial data
+		else if(ev[i].data.fd == port.serial_fd)
+		{
+			if(SerialComm_RxRoutine)
+			{
+				SerialComm_RxRoutine();
+			}
+			flag |= POSIX_WAIT_SERIAL;
+		}
+	}
+
+	return flag;
+}
+
+/** Timer thread. The routine is called as many times as the timer expired
+ * so that the tick count is kept even if the thread is delayed.
+ */
+static void *PosixPort_TimerThread(void *arg)
+{
+	struct pollfd pfd;
+	uint64_t count;
+
+	(void)arg;
+
+	pfd.fd = port.timer_fd;
+	pfd.events = POLLIN;
+
+	while(port.running)
+	{
+		// wake up periodically to check the running flag
+		if(poll(&pfd, 1, 100) <= 0)
+		{
+			continue;
+		}
+
+		if(read(port.timer_fd, &count, sizeof(count)) != sizeof(count))
+		{
+			continue;
+		}
+
+		while(count--)
+		{
+			pthread_mutex_lock(&port.lock);
+			UsrTimer_Routine();
+			pthread_mutex_unlock(&port.lock);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Start or stop the SIGPROF timer that calls Prof_Sample() with the program
+ * counter of the interrupted thread. The program counter is given relative
+ * to the load address of the executable, so that it matches the symbols of
+ * the file as tools/profsym.py expects. A sample outside of the executable,
+ * e.g. in the C library, is counted as the activity only.
+ *
+ * Prof_Init() should be called beforehand.
+ *
+ * \param  usec sampling period of the process CPU time in usec, 0 to stop
+ * \return false if the timer cannot be set
+ */
+bool PosixPort_Profile(uint32_t usec)
+{
+	struct sigaction sa;
+	struct itimerval itv;
+
+	if(usec)
+	{
+		// the executable is the first object
+		dl_iterate_phdr(PosixPort_FindCode, NULL);
+
+		sigemptyset(&sa.sa_mask);
+		sa.sa_flags = SA_SIGINFO | SA_RESTART;
+		sa.sa_sigaction = PosixPort_ProfHandler;
+		if(sigaction(SIGPROF, &sa, NULL) < 0)
+		{
+			return false;
+		}
+	}
+
+	itv.it_interval.tv_sec = usec / 1000000;
+	itv.it_interval.tv_usec = usec % 1000000;
+	itv.it_value = itv.it_interval;
+
+	return setitimer(ITIMER_PROF, &itv, NULL) == 0;
+}
+
+/** Record the load address and the range of the executable segments of the
+ * first object, which is the executable itself.
+ */
+static int PosixPort_FindCode(struct dl_phdr_info *info, size_t size,
+		void *data)
+{
+	uintptr_t low, high;
+	int i;
+
+	(void)size;
+	(void)data;
+
+	port.base = info->dlpi_addr;
+	port.low = UINTPTR_MAX;
+	port.high = 0;
+
+	for(i = 0; i < info->dlpi_phnum; i++)
+	{
+		if((info->dlpi_phdr[i].p_type == PT_LOAD) &&
+				(info->dlpi_phdr[i].p_flags & PF_X))
+		{
+			low = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+			high = low + info->dlpi_phdr[i].p_memsz;
+			port.low = (low < port.low) ? low : port.low;
+			port.high = (high > port.high) ? high : port.high;
+		}
+	}
+
+	// stop at the first object
+	return 1;
+}
+
+/** SIGPROF handler: take the program counter from the signal context.
+ */
+static void PosixPort_ProfHandler(int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = (ucontext_t *)context;
+	uintptr_t pc = 0;
+
+	(void)sig;
+	(void)info;
+
+#if defined(__x86_64__)
+	pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__i386__)
+	pc = (uintptr_t)uc->uc_mcontext.gregs[REG_EIP];
+#elif defined(__aarch64__)
+	pc = (uintptr_t)uc->uc_mcontext.pc;
+#elif defined(__arm__)
+	pc = (uintptr_t)uc->uc_mcontext.arm_pc;
+#else
+	(void)uc;
+#endif
+
+	if((pc >= port.low) && (pc < port.high))
+	{
+		Prof_Sample((uint32_t)(pc - port.base));
+	}
+	else
+	{
+		Prof_Sample(0);
+	}
+}
+
+/** Lock out the timer thread. Can be nested.
+ */
+void HAL_SuspendTick(void)
+{
+	pthread_mutex_lock(&port.lock);
+}
+
+/** Release the timer thread.
+ */
+void HAL_ResumeTick(void)
+{
+	pthread_mutex_unlock(&port.lock);
+}
+
+/** msec since PosixPort_Init()
+ */
+uint32_t HAL_GetTick(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint32_t)((now.tv_sec - port.start.tv_sec) * 1000 +
+			(now.tv_nsec - port.start.tv_nsec) / 1000000);
+}
+
+/** Thread-safe version of UsrTimer_Enable(). Once it returns with false,
+ * UsrTimer_Routine() is not running and will not run until enabled again.
+ */
+void UsrTimer_Enable(bool flag)
+{
+	pthread_mutex_lock(&port.lock);
+	usrtimer_enable = flag;
+	pthread_mutex_unlock(&port.lock);
+}
+
+/** The timer thread stands for the interrupts: lock it out. The lock is
+ * recursive, thus the section can be used in the timer callbacks as well.
+ */
+uint32_t IrqLock_Enter(void)
+{
+	pthread_mutex_lock(&port.lock);
+
+	return 0;
+}
+
+/** Release the lock taken by IrqLock_Enter().
+ */
+void IrqLock_Exit(uint32_t state)
+{
+	(void)state;
+	pthread_mutex_unlock(&port.lock);
+}
+
+/** Wake up PosixPort_Wait().
+ */
+void Evt_Signal(void)
+{
+	uint64_t one = 1;
+
+	if(port.event_fd >= 0)
+	{
+		if(write(port.event_fd, &one, sizeof(one)) < 0)
+		{
+			// counter overflow: the consumer is awake anyway
+		}
+	}
+}
+
+/** Send a byte to the serial port.
+ */
+void SerialComm_SendByte(uint8_t byte)
+{
+	SerialComm_SendByteArray(&byte, 1);
+}
+
+/** Send the bytes to the serial port. Waits for the room if the output
+ * buffer is full.
+ */
+void SerialComm_SendByteArray(uint8_t *buffer, int size)
+{
+	struct pollfd pfd;
+	ssize_t n;
+
+	if(port.serial_fd < 0)
+	{
+		return;
+	}
+
+	pfd.fd = port.serial_fd;
+	pfd.events = POLLOUT;
+
+	while(size > 0)
+	{
+		n = write(port.serial_fd, buffer, size);
+		if(n > 0)
+		{
+			buffer += n;
+			size -= n;
+		}
+		else if((n < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+		{
+			poll(&pfd, 1, 100);
+		}
+		else
+		{
+			break;
+		}
+	}
+}
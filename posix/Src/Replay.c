@@ -0,0 +1,184 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "Replay.h"
+#include "InputRec.h"
+#include "UsrTimer.h"
+#include "EvtQueue.h"
+#include "PushButton.h"
+#include "SerialComm.h"
+
+static struct
+{
+	const uint8_t *log;
+	int size;
+	int pos;				///< next record
+	bool last;				///< last tick of the current REC_TICKS
+	uint8_t button;			///< current button state
+	uint32_t ticks;
+} rp;
+
+/**
+ * Find the dump packets of InputRec_Dump() in the serial capture and
+ * concatenate their records. Other packets and bytes are skipped.
+ *
+ * \param  capture bytes captured from the serial port
+ * \param  size size of the capture
+ * \param  log storage for the records
+ * \param  max size of the storage
+ * \return number of bytes stored
+ */
+int Replay_Extract(const uint8_t *capture, int size, uint8_t *log, int max)
+{
+	uint8_t csum;
+	int i, j, len;
+	int n = 0;
+
+	for(i = 0; i + 2 < size; )
+	{
+		len = capture[i + 1];
+
+		// header, tag and a complete packet
+		if((capture[i] != PKT_HEADR) || (len < 1) || (i + 2 + len >= size) ||
+				(capture[i + 2] != INPUTREC_TAG))
+		{
+			i++;
+			continue;
+		}
+
+		csum = 0;
+		for(j = 0; j < len; j++)
+		{
+			csum ^= capture[i + 2 + j];
+		}
+		if(csum != capture[i + 2 + len])
+		{
+			i++;
+			continue;
+		}
+
+		// records only
+		for(j = 1; (j + 1 < len + 1) && (n + 2 <= max); j += 2)
+		{
+			log[n++] = capture[i + 2 + j];
+			log[n++] = capture[i + 3 + j];
+		}
+
+		i += len + 3;
+	}
+
+	return n;
+}
+
+/**
+ * Feed the records to the utilities in the recorded order.
+ *	- REC_TICKS: UsrTimer_Routine() is called for each tick
+ *	- REC_BUTTON: taken by PushButton_Read() at the last tick before it
+ *	- REC_EDGE: PushButton_Edge() is called
+ *	- REC_SERIAL: the byte is fed to SerialComm_Decoder()
+ *	- REC_DEQUEUE: an event is retrieved by Evt_DeQueue()
+ *
+ * \param  log records
+ * \param  size size of the records in bytes
+ * \param  h handlers, NULL for none
+ * \return false if the replay diverged, i.e. the queue was empty where
+ *         the target retrieved an event or the event code did not match
+ */
+bool Replay_Run(const uint8_t *log, int size, const replay_handler *h)
+{
+	uint8_t event[EVT_QWIDTH];
+	uint8_t packet[MAX_PKTSIZE];
+	uint8_t type, value;
+	bool flag = true;
+	int k;
+
+	rp.log = log;
+	rp.size = size;
+	rp.pos = 0;
+	rp.ticks = 0;
+
+	while(rp.pos + 1 < rp.size)
+	{
+		type = rp.log[rp.pos];
+		value = rp.log[rp.pos + 1];
+		rp.pos += 2;
+
+		switch(type)
+		{
+			case REC_TICKS:
+				for(k = 0; k < value; k++)
+				{
+					rp.last = (k == value - 1);
+					UsrTimer_Routine();
+					rp.ticks++;
+				}
+				rp.last = false;
+				break;
+
+			// not taken by PushButton_Read(): keep it for the next read
+			case REC_BUTTON:
+				rp.button = value;
+				break;
+
+			case REC_EDGE:
+				PushButton_Edge();
+				break;
+
+			case REC_SERIAL:
+				if(PKT_RECEIVED == SerialComm_Decoder(value, packet))
+				{
+					if(h && h->packet)
+					{
+						h->packet(packet);
+					}
+				}
+				break;
+
+			case REC_DEQUEUE:
+				if(Evt_DeQueue(event) && (event[0] == value))
+				{
+					if(h && h->event)
+					{
+						h->event(event);
+					}
+				}
+				else
+				{
+					flag = false;
+				}
+				break;
+
+			default:
+				flag = false;
+				break;
+		}
+	}
+
+	return flag;
+}
+
+/**
+ * \return number of ticks replayed, i.e. the simulated clock
+ */
+uint32_t Replay_Ticks(void)
+{
+	return rp.ticks;
+}
+
+/**
+ * Recorded button state. The button record that follows the current group
+ * of ticks belongs to the read at its last tick.
+ */
+uint8_t PushButton_Read(void)
+{
+	if(rp.last && (rp.pos + 1 < rp.size) && (rp.log[rp.pos] == REC_BUTTON))
+	{
+		rp.button = rp.log[rp.pos + 1];
+		rp.pos += 2;
+	}
+
+	return rp.button;
+}
@@ -0,0 +1,98 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Run-to-completion active objects
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * An active object owns an event queue, a handler and a unique priority.
+ * Events posted to an object are processed by its handler one at a time,
+ * each call running to completion. ActObj_Run() picks the highest priority
+ * object among those with pending events by looking up the ready bitmap,
+ * so that a busy low priority object does not delay the others.
+ *
+ * The event format is the same as EvtQueue: one byte of event code followed
+ * by the event data, up to EVT_QWIDTH bytes.
+ *
+ * Time events post an event with a given code to an object periodically.
+ * They are driven by a tick function of the UsrTimer registered by
+ * ActObj_Init(), so that their unit is the base tick of the UsrTimer and the
+ * timers of other modules keep running.
+ *
+\code
+static uint8_t app_buff[8][EVT_QWIDTH];
+static actobj app;
+
+void app_handler(uint8_t *event)
+{
+	switch(event[0])
+	{
+		case EVT_APP_BLINK:
+		...
+	}
+}
+
+main()
+{
+	ActObj_Init();
+	ActObj_Start(&app, 1, app_buff, 8, app_handler);
+	// post EVT_APP_BLINK every 500 ticks
+	ActObj_TimeEvt(&app, EVT_APP_BLINK, 500, 0);
+
+	while(1)
+	{
+		if(!ActObj_Run())
+		{
+			// nothing to do: sleep until the next interrupt
+			__WFI();
+		}
+	}
+}
+\endcode
+ *
+ * Unlike EvtQueue, the access to the queue and to the ready bitmap is
+ * protected by IrqLock, which masks all interrupts, so that ActObj_Post()
+ * can be called from any interrupt such as the UART receive callback.
+ */
+
+#ifndef __ACT_OBJ_H
+#define __ACT_OBJ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "EvtQueue.h"
+
+/// Maximum number of active objects. Should not exceed 32.
+#define ACT_MAX_OBJ				8
+/// Maximum number of time events
+#define ACT_MAX_TEVT			8
+
+/// Event handler of the active object
+typedef void (* actobj_handler)(uint8_t *event);
+
+/// Active object
+typedef struct
+{
+	uint8_t (*buff)[EVT_QWIDTH];	///< event queue storage
+	uint8_t depth;					///< number of slots of the queue
+	uint8_t head;
+	uint8_t tail;
+	uint8_t prio;					///< priority, higher value runs first
+	actobj_handler handler;			///< event handler
+} actobj;
+
+/// Initialize the scheduler
+void ActObj_Init(void);
+/// Register an active object
+bool ActObj_Start(actobj *ao, uint8_t prio, uint8_t (*buff)[EVT_QWIDTH],
+		uint8_t depth, actobj_handler handler);
+/// Post an event to the active object
+bool ActObj_Post(actobj *ao, uint8_t *event);
+/// Process one event of the highest priority object
+bool ActObj_Run(void);
+/// Set a time event
+int ActObj_TimeEvt(actobj *ao, uint8_t code, uint32_t period,
+		uint32_t duration);
+/// Clear the time event
+void ActObj_ClearTimeEvt(int index);
+
+#endif // __ACT_OBJ_H
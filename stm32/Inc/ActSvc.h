@@ -0,0 +1,91 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	PushButton and SerialComm as active objects
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * This program runs PushButton and SerialComm as active objects, so that
+ * the button scan and the packet decoding take place in the main loop at
+ * their own priority, rather than in the timer interrupt or in the shared
+ * event queue.
+ *
+ * The PushButton object scans the buttons on its time event and sends the
+ * pushbutton events to the given sink. The SerialComm object takes the
+ * received bytes posted by ActSvc_SerialRx() and sends the following
+ * events to the given sink:
+\verbatim
+(EVT_SCOM_PACKET)(HANDLE)           HANDLE of the EvtPool block
+(EVT_SCOM_STATUS)(pkt_status)       for ACK, NAK, IAM and errors
+\endverbatim
+ * The packet is decoded directly into an EvtPool block, which holds the
+ * whole packet as returned by SerialComm_Decoder(). The reference of the
+ * block goes with the event, so the receiver calls EvtPool_Release() when
+ * done with the packet. If the sink refuses the event, the block is
+ * released by the object. When the pool is exhausted, the packet is
+ * dropped and reported as PKT_DROPPED.
+ *
+\code
+static actobj app;
+
+bool app_sink(uint8_t *event)
+{
+	return ActObj_Post(&app, event);
+}
+
+void app_handler(uint8_t *event)
+{
+	if(event[0] == EVT_SCOM_PACKET)
+	{
+		process_packet(EvtPool_Data(event[1]));
+		EvtPool_Release(event[1]);
+	}
+	...
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+	ActSvc_SerialRx(&rx_byte, 1);
+	...
+}
+
+main()
+{
+	EvtPool_Init();
+	ActObj_Init();
+	ActObj_Start(&app, 1, app_buff, 8, app_handler);
+	ActSvc_InitPushButton(0x01, 3, app_sink);
+	ActSvc_InitSerialComm(2, app_sink);
+	...
+}
+\endcode
+ */
+
+#ifndef __ACT_SVC_H
+#define __ACT_SVC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ActObj.h"
+#include "SerialComm.h"
+#include "EvtPool.h"
+
+// event codes of the SerialComm object. define them in myevents.h if these
+// values collide with other event codes.
+#ifndef EVT_SCOM_PACKET
+#define EVT_SCOM_PACKET			0xe0	///< packet received
+#endif
+#ifndef EVT_SCOM_STATUS
+#define EVT_SCOM_STATUS			0xe1	///< decoder status other than packet
+#endif
+
+/// Queue depth of the service objects
+#define ACTSVC_QDEPTH			4
+
+/// Start the PushButton object
+bool ActSvc_InitPushButton(uint8_t mask, uint8_t prio, evt_sink sink);
+/// Start the SerialComm object
+bool ActSvc_InitSerialComm(uint8_t prio, evt_sink sink);
+/// Pass received bytes to the SerialComm object
+bool ActSvc_SerialRx(uint8_t *bytes, int size);
+
+#endif // __ACT_SVC_H
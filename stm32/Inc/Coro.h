@@ -0,0 +1,158 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Stackless coroutine tasks
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * This program allows a multi-step sequence to be written as a single
+ * function that waits for time or for an event in the middle, without a
+ * stack of its own. The function returns at each wait and is resumed at
+ * the same point later, in the manner of protothreads. The state of a task
+ * is a coro_task structure of a few bytes.
+ *
+ * Since the function returns at each wait, local variables do not survive
+ * the wait. Keep them in a structure that embeds coro_task as its first
+ * member, or in static variables. Also the wait macros cannot be used
+ * inside a switch statement of the task function.
+ *
+ * The wait primitives are:
+ *	- CORO_AWAIT_TICKS(t, n): resume after n UsrTimer ticks
+ *	- CORO_AWAIT_EVENT(t, code, timeout): resume when an event with the
+ *	  code is dispatched, or after timeout ticks (0 for no timeout)
+ *	- CORO_AWAIT_PACKET(t, sid, timeout): resume when a packet of the
+ *	  session sid is received from the SerialComm object (see ActSvc.h);
+ *	  t->event[1] is the EvtPool handle
+ *
+ * The tick count is kept by a UsrTimer tick function registered by
+ * Coro_Init(), thus it does not hold off the timers of other modules. Call
+ * Coro_Run() in the main loop for the timeouts, and pass each event to
+ * Coro_Dispatch(). The event is valid in the task only until the next wait.
+ *
+ * The first payload byte of a packet is taken as the session id. Each
+ * packet is handed to exactly one task, the first one waiting for its
+ * session, which then owns the reference of the block and should call
+ * EvtPool_Release() before the next wait. Coro_Dispatch() returns false if
+ * no task took the packet, in which case the caller releases it.
+ *
+\code
+typedef struct
+{
+	coro_task task;			// should be the first member
+	uint8_t retry;
+	uint8_t payload[5];		// payload[0] is the session id
+} session;
+
+void session_func(coro_task *t)
+{
+	session *s = (session *)t;
+
+	CORO_BEGIN(t);
+
+	for(s->retry = 0; s->retry < 3; s->retry++)
+	{
+		SerialComm_SendPacket(s->payload, 5);
+		// wait for the answer of this session up to 50 msec
+		CORO_AWAIT_PACKET(t, s->payload[0], 50);
+		if(!CORO_TIMEDOUT(t))
+		{
+			process_answer(EvtPool_Data(t->event[1]));
+			// the packet belongs to this task
+			EvtPool_Release(t->event[1]);
+			break;
+		}
+	}
+
+	CORO_END(t);
+}
+
+main()
+{
+	Coro_Init();
+	Coro_Start(&s1.task, session_func);
+
+	while(1)
+	{
+		if(Evt_DeQueue(event))
+		{
+			// packet of no session
+			if(!Coro_Dispatch(event) && (event[0] == EVT_SCOM_PACKET))
+			{
+				EvtPool_Release(event[1]);
+			}
+			...
+		}
+		Coro_Run();
+	}
+}
+\endcode
+ */
+
+#ifndef __CORO_H
+#define __CORO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Maximum number of tasks
+#define CORO_MAX_TASK			32
+
+/// Task wait state
+#define CORO_READY				0	///< run at the next Coro_Run()
+#define CORO_TICKS				1	///< waiting for the deadline
+#define CORO_EVENT				2	///< waiting for an event
+#define CORO_DONE				3	///< finished
+#define CORO_PACKET				4	///< waiting for a packet of a session
+
+typedef struct coro_task coro_task;
+typedef void (* coro_func)(coro_task *t);
+
+/// Task structure
+struct coro_task
+{
+	uint16_t lc;				///< resume point
+	uint8_t wait;				///< wait state
+	uint8_t code;				///< event code or session id waiting for
+	uint32_t deadline;			///< tick count to resume
+	uint8_t *event;				///< event that resumed the task
+	coro_func func;				///< task function
+};
+
+/// Start of the task function body
+#define CORO_BEGIN(t)			switch((t)->lc) { case 0:
+/// End of the task function body
+#define CORO_END(t)				} (t)->lc = 0; (t)->wait = CORO_DONE; return
+
+/// Return and resume here later
+#define CORO_WAIT_(t)			do { (t)->lc = __LINE__; return; \
+									case __LINE__:; } while(0)
+/// Let other tasks run
+#define CORO_YIELD(t)			do { Coro_Wait((t), CORO_READY, 0, 0); \
+									CORO_WAIT_(t); } while(0)
+/// Wait for n ticks
+#define CORO_AWAIT_TICKS(t, n)	do { Coro_Wait((t), CORO_TICKS, 0, (n)); \
+									CORO_WAIT_(t); } while(0)
+/// Wait for an event with the code, or for the timeout if not zero
+#define CORO_AWAIT_EVENT(t, c, to)	do { Coro_Wait((t), CORO_EVENT, (c), (to)); \
+									CORO_WAIT_(t); } while(0)
+/// Wait for a packet of the session, or for the timeout if not zero
+#define CORO_AWAIT_PACKET(t, sid, to)	do { Coro_Wait((t), CORO_PACKET, (sid), \
+									(to)); CORO_WAIT_(t); } while(0)
+/// True if the event wait ended by the timeout
+#define CORO_TIMEDOUT(t)		((t)->event == NULL)
+
+/// Initialize the task list and the tick count
+void Coro_Init(void);
+/// Register and start the task
+bool Coro_Start(coro_task *t, coro_func func);
+/// Remove the task
+void Coro_Stop(coro_task *t);
+/// Resume the tasks whose deadline has passed
+bool Coro_Run(void);
+/// Resume the tasks waiting for the event
+bool Coro_Dispatch(uint8_t *event);
+/// Set the wait condition (used by the wait macros)
+void Coro_Wait(coro_task *t, uint8_t wait, uint8_t code, uint32_t ticks);
+/// Current tick count
+uint32_t Coro_Ticks(void);
+
+#endif // __CORO_H
@@ -0,0 +1,88 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Fixed-block memory pool for large event data
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * An event can hold no more than EVT_QWIDTH bytes. Larger data such as a
+ * received packet or a block of samples is put in a block of this pool and
+ * the event carries the one-byte handle of the block instead:
+\verbatim
+(EVT_CODE)(HANDLE)(EVT_DATA...)
+\endverbatim
+ * The handle zero is reserved for no block.
+ *
+ * Each block has a reference count. EvtPool_Alloc() returns a block with
+ * the count of one, owned by the caller. Whoever passes the handle to
+ * another consumer either hands over its reference or calls EvtPool_Retain()
+ * for the new one, and each consumer calls EvtPool_Release() when done.
+ * The block returns to the pool when the count reaches zero.
+ *
+ * The free blocks are kept in a bitmap updated by atomic compare-and-swap,
+ * so that the functions can be called from interrupts and from the main
+ * loop without a lock. On cores without exclusive access instructions
+ * (ARMv6-M such as Cortex-M0), the updates are made with the interrupts
+ * masked by IrqLock instead.
+ *
+ * A release of a block whose count is already zero, e.g. a second release
+ * by the same owner, is reported by EVTPOOL_FAULT() and does not change the
+ * pool. By default it is assert(), which can be replaced by a breakpoint
+ * or an error log of the project.
+ *
+\code
+// producer
+uint8_t handle = EvtPool_Alloc();
+if(handle)
+{
+	fill_block(EvtPool_Data(handle));
+	event[0] = EVT_APP_BLOCK;
+	event[1] = handle;
+	// the reference goes with the event
+	if(!Evt_EnQueue(event))
+	{
+		EvtPool_Release(handle);
+	}
+}
+
+// consumer
+case EVT_APP_BLOCK:
+	process_block(EvtPool_Data(event[1]));
+	EvtPool_Release(event[1]);
+	break;
+\endcode
+ */
+
+#ifndef __EVT_POOL_H
+#define __EVT_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Number of blocks. Should not exceed 32.
+#ifndef EVTPOOL_BLOCKS
+#define EVTPOOL_BLOCKS			8
+#endif
+/// Size of a block in bytes
+#ifndef EVTPOOL_BSIZE
+#define EVTPOOL_BSIZE			64
+#endif
+
+/// Called with the handle on a double release
+#ifndef EVTPOOL_FAULT
+#define EVTPOOL_FAULT(handle)	assert(!"EvtPool: block released twice")
+#endif
+
+/// Clear the pool
+void EvtPool_Init(void);
+/// Take a free block
+uint8_t EvtPool_Alloc(void);
+/// Address of the block
+uint8_t *EvtPool_Data(uint8_t handle);
+/// Add a reference to the block
+void EvtPool_Retain(uint8_t handle);
+/// Drop a reference to the block
+bool EvtPool_Release(uint8_t handle);
+/// Number of free blocks
+int EvtPool_Free(void);
+
+#endif // __EVT_POOL_H
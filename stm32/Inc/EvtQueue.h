@@ -70,11 +70,22 @@ if(flag)
 #define EVT_QWIDTH				(16)
 
 
+/// Event destination such as Evt_EnQueue
+typedef bool (* evt_sink)(uint8_t *event);
+/// Queue occupancy notification: true at the high watermark, false at low
+typedef void (* evt_watermark)(bool busy);
+
 /// Register a new event
 bool Evt_EnQueue(uint8_t *event);
 /// Checkout the oldest event
 bool Evt_DeQueue(uint8_t *event);
 /// Initialize the event queue
 void Evt_InitQueue(void);
+/// Notify the consumer of a new event
+void Evt_Signal(void);
+/// Number of events in the queue
+uint8_t Evt_Count(void);
+/// Set the occupancy watermarks for flow control
+void Evt_SetWatermark(uint8_t high, uint8_t low, evt_watermark f);
 
 #endif // __EVT_QUEUE_H
@@ -0,0 +1,90 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Input recorder for offline replay
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * This program records the inputs of the utilities in the order they
+ * arrive, so that a session can be fed back through the same code on a
+ * workstation (see posix/Inc/Replay.h). The recorded inputs are:
+ *	- the ticks of UsrTimer_Routine() that actually ran
+ *	- the value of PushButton_Read() whenever it changes
+ *	- PushButton_Edge() calls
+ *	- the bytes fed to SerialComm_Decoder()
+ *	- the events retrieved by Evt_DeQueue()
+ *
+ * The recording points are compiled only when INPUTREC_ENABLE is defined.
+ * Each record takes two bytes, (TYPE)(VALUE). Consecutive ticks are
+ * merged into a single REC_TICKS record. Recording stops when the buffer
+ * is full.
+ *
+ * InputRec_Dump() sends the records over SerialComm in packets of
+\verbatim
+(INPUTREC_TAG)(TYPE)(VALUE)(TYPE)(VALUE)...
+\endverbatim
+ * While the peer is busy, InputRec_Dump() returns false and should be
+ * called again later to send the rest.
+ *
+ * The decoder bytes are recorded with the interrupts masked by IrqLock, so
+ * that they can come from the main loop or from the UART interrupt. Other interrupts that
+ * call the recorded functions, such as the EXTI callback calling
+ * PushButton_Edge(), should not preempt the timer interrupt or a recording
+ * in progress.
+ */
+
+#ifndef __INPUT_REC_H
+#define __INPUT_REC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Size of the record buffer in bytes
+#ifndef INPUTREC_SIZE
+#define INPUTREC_SIZE			2048
+#endif
+/// First payload byte of the dump packet
+#ifndef INPUTREC_TAG
+#define INPUTREC_TAG			0xfb
+#endif
+
+/// Record types
+#define REC_TICKS				0x01	///< number of ticks passed
+#define REC_BUTTON				0x02	///< PushButton_Read() value
+#define REC_SERIAL				0x03	///< byte fed to the decoder
+#define REC_DEQUEUE				0x04	///< event retrieved: event code
+#define REC_EDGE				0x05	///< PushButton_Edge() called
+
+#ifdef INPUTREC_ENABLE
+#define INPUTREC_TICK()			InputRec_Tick()
+#define INPUTREC_BUTTON(v)		InputRec_Button(v)
+#define INPUTREC_SERIAL(b)		InputRec_Serial(b)
+#define INPUTREC_DEQUEUE(c)		InputRec_Record(REC_DEQUEUE, (c))
+#define INPUTREC_EDGE()			InputRec_Record(REC_EDGE, 0)
+#else
+#define INPUTREC_TICK()			((void)0)
+#define INPUTREC_BUTTON(v)		((void)0)
+#define INPUTREC_SERIAL(b)		((void)0)
+#define INPUTREC_DEQUEUE(c)		((void)0)
+#define INPUTREC_EDGE()			((void)0)
+#endif
+
+/// Clear the buffer and start recording
+void InputRec_Start(void);
+/// Stop recording
+void InputRec_Stop(void);
+/// Send the records over SerialComm
+bool InputRec_Dump(void);
+/// Number of bytes recorded
+int InputRec_Size(void);
+/// True if recording stopped because the buffer is full
+bool InputRec_Overflow(void);
+/// Count a tick
+void InputRec_Tick(void);
+/// Record the button state if changed
+void InputRec_Button(uint8_t value);
+/// Record a byte fed to the decoder
+void InputRec_Serial(uint8_t byte);
+/// Add a record
+void InputRec_Record(uint8_t type, uint8_t value);
+
+#endif // __INPUT_REC_H
@@ -0,0 +1,34 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Critical section against all interrupts
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * UsrTimer_Enable() holds off UsrTimer_Routine() only. Data shared with
+ * other interrupts, such as the UART receive callback, needs all the
+ * interrupts masked. On Cortex-M, IrqLock_Enter() saves PRIMASK and masks
+ * the interrupts, and IrqLock_Exit() restores the saved value, so that the
+ * sections can be nested and used inside interrupts.
+ *
+\code
+uint32_t state = IrqLock_Enter();
+// short access to the shared data
+IrqLock_Exit(state);
+\endcode
+ *
+ * The functions are weak so that the platform can provide its own. The
+ * default for the host does nothing, since the host stubs have no
+ * interrupt, and the POSIX port locks out the timer thread instead.
+ */
+
+#ifndef __IRQ_LOCK_H
+#define __IRQ_LOCK_H
+
+#include <stdint.h>
+
+/// Mask the interrupts and return the previous state
+uint32_t IrqLock_Enter(void);
+/// Restore the state returned by IrqLock_Enter()
+void IrqLock_Exit(uint32_t state);
+
+#endif // __IRQ_LOCK_H
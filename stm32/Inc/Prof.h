@@ -0,0 +1,128 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Tick-driven statistical profiler
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * This program takes a sample of what the main loop is doing at every tick
+ * and builds a histogram, so that the hot spots can be found without a
+ * debugger. Each sample counts:
+ *	- the current activity, set by PROF_ACTIVITY() at key points of the
+ *	  application, in a table of PROF_MAX_ACT counters
+ *	- the program counter of the interrupted code, if available, in a hash
+ *	  table of PROF_BUCKETS entries
+ *
+ * Prof_Tick() takes the activity only and can be called next to
+ * UsrTimer_Routine():
+\code
+void HAL_SYSTICK_Callback(void)
+{
+	Prof_Tick();
+	UsrTimer_Routine();
+}
+\endcode
+ *
+ * The program counter is in the exception frame stacked on the entry of the
+ * interrupt, which is not reachable from the HAL callback. To sample it,
+ * rename the SysTick_Handler() of the project to SysTick_Handler_HAL() and
+ * put the following in front of it (Cortex-M3/M4/M7):
+\code
+__attribute__((naked)) void SysTick_Handler(void)
+{
+	__asm volatile(
+		"tst   lr, #4              \n"
+		"ite   eq                  \n"
+		"mrseq r0, msp             \n"
+		"mrsne r0, psp             \n"
+		"push  {r4, lr}            \n"
+		"bl    Prof_SampleFrame    \n"
+		"pop   {r4, lr}            \n"
+		"b     SysTick_Handler_HAL \n");
+}
+\endcode
+ *
+ * The utilities mark their own activities when PROF_ENABLE is defined:
+ * PROF_ACT_TIMER in UsrTimer_Routine(), PROF_ACT_EVENT while ActObj_Run()
+ * dispatches an event to the handler, and PROF_ACT_DECODE in
+ * SerialComm_Decode(). Each restores the previous activity when it
+ * returns, so that the activity of the interrupted code is kept. The
+ * application uses PROF_ACT_USER and above. Note that the sample taken in
+ * the tick interrupt before UsrTimer_Routine() does not see
+ * PROF_ACT_TIMER of the same tick; the timer activity is seen by a sampler
+ * of its own, such as PosixPort_Profile(), or a higher priority interrupt.
+ *
+ * When the hash table is full, the samples of new program counters are
+ * counted as lost. Prof_Dump() sends the histogram over SerialComm, one
+ * record per packet. The payload is
+\verbatim
+(PROF_TAG)(PROF_REC_SUMMARY)(SAMPLES:4)(LOST:4)
+(PROF_TAG)(PROF_REC_ACT)(ACTIVITY)(COUNT:4)
+(PROF_TAG)(PROF_REC_PC)(PC:4)(COUNT:4)
+\endverbatim
+ * where multi-byte values are in big endian order. tools/profsym.py
+ * symbolizes the captured serial stream against the ELF file. While the
+ * peer is busy, Prof_Dump() returns false and should be called again later
+ * to send the rest.
+ *
+ * On Linux, PosixPort_Profile() drives Prof_Sample() from a SIGPROF timer.
+ */
+
+#ifndef __PROF_H
+#define __PROF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Number of entries of the hash table. Should be a power of 2.
+#define PROF_BUCKETS			128
+/// Maximum number of entries looked up for a program counter
+#define PROF_PROBE				8
+/// Number of activities, 0 being the default
+#define PROF_MAX_ACT			16
+/// First payload byte of the dump packet
+#ifndef PROF_TAG
+#define PROF_TAG				0xfc
+#endif
+
+/// Record types of the dump
+#define PROF_REC_SUMMARY		0x00	///< number of samples and lost ones
+#define PROF_REC_ACT			0x01	///< samples of an activity
+#define PROF_REC_PC				0x02	///< samples of a program counter
+
+/// Activities of the utilities
+#define PROF_ACT_IDLE			0x00	///< none marked, e.g. the main loop
+#define PROF_ACT_TIMER			0x01	///< UsrTimer_Routine()
+#define PROF_ACT_EVENT			0x02	///< event handler of ActObj_Run()
+#define PROF_ACT_DECODE			0x03	///< SerialComm_Decode()
+#define PROF_ACT_USER			0x04	///< first activity of the application
+
+/// Current activity, written by PROF_ACTIVITY()
+extern volatile uint8_t prof_activity;
+
+// PROF_ENTER() declares the saved activity, thus it should be the last of
+// the declarations of the function, and PROF_LEAVE() restores it.
+#ifdef PROF_ENABLE
+#define PROF_ACTIVITY(a)		(prof_activity = (a))
+#define PROF_ENTER(a)			uint8_t prof_saved = prof_activity; \
+								prof_activity = (a)
+#define PROF_LEAVE()			(prof_activity = prof_saved)
+#else
+#define PROF_ACTIVITY(a)		((void)0)
+#define PROF_ENTER(a)			((void)0)
+#define PROF_LEAVE()			((void)0)
+#endif
+
+/// Clear the histogram and start sampling
+void Prof_Init(void);
+/// Stop sampling
+void Prof_Stop(void);
+/// Take a sample of the activity only
+void Prof_Tick(void);
+/// Take a sample of the activity and the program counter
+void Prof_Sample(uint32_t pc);
+/// Take a sample from the exception frame
+void Prof_SampleFrame(uint32_t *frame);
+/// Send the histogram over SerialComm
+bool Prof_Dump(void);
+
+#endif // __PROF_H
@@ -24,7 +24,39 @@
  * The main routine, PushButton_Routine() keeps track of the button state
  * and post an event when certain conditions are met. In the current
  * implementation, it will generate following events: single click, double
- * click, triple click and long click.
+ * click, triple click, N-click, long click, hold repeat and chord.
+ *
+ * Each button in CLICK mode runs its own state machine (idle, down, up,
+ * hold and ignore), whose transitions are given by a constant table
+ * indexed by the state and the input of the scan. The event data is
+\verbatim
+(EVT_PBTN_INPUT)(button id)(event code)(click count or chord mask)
+\endverbatim
+ *
+ * Each button can have its own detection profile, which sets the highest
+ * click count to detect, the multi-click window and the long click
+ * threshold. The time to the event, in PUSHBTN_TMR_PERIOD counted from the
+ * scan that sees the last edge, is as follows:
+\verbatim
+	gesture         max_click   latency
+	single click    1           0 from the release
+	single click    2 or more   to_short from the release
+	double click    2           0 from the second release
+	double click    3 or more   to_short from the second release
+	triple click    3           0 from the third release
+	N click         N           0 from the N-th release
+	long click      any         to_long from the press
+\endverbatim
+ * The scan comes up to one period after the edge itself. The figures are
+ * measured by test/TestPushButtonLatency.c.
+ * The default profile is the same as the PUSHBTN_TO_SHORT and
+ * PUSHBTN_TO_LONG with triple click.
+ *
+ * Instead of scanning all the time, the routine can be started by a button
+ * edge. Call PushButton_InitEdge() instead of PushButton_Init() and call
+ * PushButton_Edge() from the GPIO EXTI callback of the buttons. The first
+ * scan then takes place PUSHBTN_DEBOUNCE after the edge, and the routine
+ * stops when all buttons are released and no click is pending.
  *
 \code
 // override PushButton_Read() function
@@ -67,6 +99,7 @@ main()
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "EvtQueue.h"
 
 /// PushButton_Routine timer period in msec
 #define PUSHBTN_TMR_PERIOD		80
@@ -74,14 +107,54 @@ main()
 #define PUSHBTN_TO_SHORT		3		// 3 * PUSHBTN_TMR_PERIOD
 #define PUSHBTN_TO_LONG			10		// 10 * PUSHBTN_TMR_PERIOD
 #define PUSHBTN_TO_MAX			255		// maximum duration count
+/// Delay from the edge to the first scan in edge mode in msec
+#define PUSHBTN_DEBOUNCE		20
+/// Maximum number of chords
+#define PUSHBTN_MAX_CHORD		4
 
 #define PUSHBTN_MODE_CLICK		0x00	// click mode: detect change
 #define PUSHBTN_MODE_UDOWN		0x01	// up down mode: detect level
 
+// event codes of the gesture engine. define them in myevents.h if these
+// values collide with other event codes.
+#ifndef PBTN_NCLK
+#define PBTN_NCLK				0x10	///< more than three clicks
+#endif
+#ifndef PBTN_RPT
+#define PBTN_RPT				0x11	///< hold repeat after long click
+#endif
+#ifndef PBTN_CHRD
+#define PBTN_CHRD				0x12	///< chord
+#endif
+
+/// Detection profile of a button
+typedef struct
+{
+	uint8_t max_click;		///< highest click count to detect
+	uint8_t to_short;		///< multi-click window in PUSHBTN_TMR_PERIOD
+	uint8_t to_long;		///< long click threshold, 0 to disable long click
+	uint8_t to_repeat;		///< first hold repeat interval, 0 to disable
+	uint8_t repeat_min;		///< shortest hold repeat interval
+} pushbtn_profile;
+
 /// Initialize the pushbutton data
 void PushButton_Init(uint8_t mask);
+/// Initialize the pushbutton data in edge-triggered mode
+void PushButton_InitEdge(uint8_t mask);
+/// Start scanning on a button edge
+void PushButton_Edge(void);
+/// Stop running the main routine by the timer
+void PushButton_Stop(void);
+/// Set the destination of the events
+void PushButton_SetSink(evt_sink sink);
+/// Main routine
+void PushButton_Routine(void);
 /// Switch detect mode between CLICK and UDOWN
 void PushButton_SetMode(uint8_t mode, bool flag);
+/// Set the detection profile of a button
+void PushButton_SetProfile(uint8_t index, const pushbtn_profile *profile);
+/// Set a chord of buttons
+void PushButton_SetChord(uint8_t index, uint8_t mask);
 /// Read all pushbutton state and return them in a uint8_t form
 uint8_t PushButton_Read(void) __attribute__((weak));
 
@@ -0,0 +1,90 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Pushbutton state check for a large number of buttons
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * This program detects the same events as PushButton does, but for up to
+ * 32 or 64 buttons such as a matrix keypad or buttons on I/O expanders.
+ * The state of all buttons is supplied by the user function
+ * PushButtonWide_Read(), one bit per button, in a pushbtnw_t word.
+ *
+ * Instead of checking each button in turn, the state of all the buttons
+ * is processed at once with a few word-wide operations. Every counter is
+ * kept as a vertical counter, where bit n of the k-th word is the k-th bit
+ * of the counter of the button n:
+ *	- a 2-bit debounce counter: a change of the state is accepted after
+ *	  it has been read four times in a row
+ *	- a PUSHBTNW_DUR_BITS-bit duration counter
+ *	- a 2-bit click counter
+ *
+ * Only the buttons that have an event to report are visited when the
+ * events are posted. Unlike PushButton, the button in UDOWN mode posts
+ * PBTN_DOWN at the press and then every PUSHBTN_TMR_PERIOD, since the scan
+ * period of this module is much shorter. Also the suppression of the false
+ * detection after a long click is done for each button separately.
+ *
+\code
+// override PushButtonWide_Read() function
+pushbtnw_t PushButtonWide_Read()
+{
+	pushbtnw_t button_state;
+
+	// scan the keypad matrix
+
+	return button_state;
+}
+
+main()
+{
+	// 4 x 8 keypad
+	PushButtonWide_Init(0xffffffff);
+	...
+}
+\endcode
+ */
+
+#ifndef __PUSH_BUTTON_WIDE_H
+#define __PUSH_BUTTON_WIDE_H
+
+#include <stdint.h>
+#include "PushButton.h"
+
+/// Number of buttons: 8, 16, 32 or 64
+#ifndef PUSHBTNW_WIDTH
+#define PUSHBTNW_WIDTH			32
+#endif
+/// PushButtonWide_Routine timer period in msec
+#define PUSHBTNW_TMR_PERIOD		10
+/// Criteria for short click and long click with the same time as PushButton
+#define PUSHBTNW_TO_SHORT		(PUSHBTN_TO_SHORT * PUSHBTN_TMR_PERIOD / PUSHBTNW_TMR_PERIOD)
+#define PUSHBTNW_TO_LONG		(PUSHBTN_TO_LONG * PUSHBTN_TMR_PERIOD / PUSHBTNW_TMR_PERIOD)
+/// Number of bits of the duration counter
+#define PUSHBTNW_DUR_BITS		7
+/// Button id of the bit 0 in the event data
+#define PUSHBTNW_ID_BASE		1
+
+#if PUSHBTNW_WIDTH == 64
+typedef uint64_t pushbtnw_t;
+#elif PUSHBTNW_WIDTH == 32
+typedef uint32_t pushbtnw_t;
+#elif PUSHBTNW_WIDTH == 16
+typedef uint16_t pushbtnw_t;
+#elif PUSHBTNW_WIDTH == 8
+typedef uint8_t pushbtnw_t;
+#else
+#error "PUSHBTNW_WIDTH should be 8, 16, 32 or 64"
+#endif
+
+/// Initialize the pushbutton data
+void PushButtonWide_Init(pushbtnw_t mask);
+/// Set the destination of the events
+void PushButtonWide_SetSink(evt_sink sink);
+/// Switch detect mode between CLICK and UDOWN
+void PushButtonWide_SetMode(pushbtnw_t mode, pushbtnw_t pressed);
+/// Main routine
+void PushButtonWide_Routine(void);
+/// Read all pushbutton state and return them in a pushbtnw_t form
+pushbtnw_t PushButtonWide_Read(void) __attribute__((weak));
+
+#endif // __PUSH_BUTTON_WIDE_H
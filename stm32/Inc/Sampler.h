@@ -0,0 +1,137 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Periodic sampling into double-buffered blocks
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * Sending each sample in its own packet costs a frame and a trip through
+ * the main loop per sample. This program collects the samples in one of
+ * two blocks of SAMPLER_BLOCK samples while the other block is being
+ * processed, and posts an event when a block is full:
+\verbatim
+(EVT_SMPL_BLOCK)(INDEX)(SEQ)
+\endverbatim
+ * where INDEX is the block (0 or 1) and SEQ counts the blocks. The block
+ * belongs to the consumer until Sampler_Release() or Sampler_Send() is done
+ * with it. If the next block fills up before that, the new samples are
+ * dropped and counted by Sampler_Lost().
+ *
+ * The samples are taken either by a UsrTimer calling the read function, or
+ * by Sampler_Push() from the interrupt of a hardware trigger such as the
+ * ADC conversion complete. In the latter case, the interrupt should not
+ * preempt the timer interrupt, as for other producers of the event queue.
+ *
+ * Sampler_Send() reduces and encodes the block in the main loop and
+ * streams it over SerialComm. The block is first decimated by the factor
+ * given to Sampler_Init(), i.e. each group of that many samples is replaced
+ * by its average in a buffer of its own, so that the block keeps the
+ * samples as they are. Then the packets are sent according to the mode:
+\verbatim
+(SAMPLER_TAG)(SAMPLER_REC_STATS)(SEQ)(MIN:2)(MAX:2)(MEAN:2)
+(SAMPLER_TAG)(SAMPLER_REC_RAW)(SEQ)(SAMPLE:2)(SAMPLE:2)...
+(SAMPLER_TAG)(SAMPLER_REC_DELTA)(SEQ)(SAMPLE:2)(DELTA:1)(DELTA:1)...
+\endverbatim
+ * The statistics are taken before decimation. In a delta packet, each
+ * DELTA is the signed difference from the previous sample. A packet ends
+ * where a difference does not fit in a byte, and the next one starts with
+ * the sample itself. Thus every packet can be decoded by itself. Multi-byte
+ * values are in big endian order. As in SerialBatch, MAX_PAYLOAD should be
+ * raised on both ends for the streaming to be effective.
+ *
+ * If the peer is busy (see SerialComm_SendPacket()), Sampler_Send() returns
+ * false and resumes from the packet refused on the next call with the same
+ * event.
+ *
+\code
+int16_t read_adc(void)
+{
+	return (int16_t)HAL_ADC_GetValue(&hadc1);
+}
+
+// 1 sample per tick, 4 samples averaged, differences sent
+Sampler_Init(4, SAMPLER_DELTA);
+Sampler_Start(1, read_adc);
+
+// main loop
+if(Evt_DeQueue(event))
+{
+	switch(event[0])
+	{
+		case EVT_SMPL_BLOCK:
+			// try again later if the peer is busy
+			if(!Sampler_Send(event))
+			{
+				Evt_EnQueue(event);
+			}
+			break;
+		...
+	}
+}
+\endcode
+ */
+
+#ifndef __SAMPLER_H
+#define __SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "EvtQueue.h"
+
+/// Number of samples in a block
+#ifndef SAMPLER_BLOCK
+#define SAMPLER_BLOCK			64
+#endif
+/// First payload byte of the sample packets
+#ifndef SAMPLER_TAG
+#define SAMPLER_TAG				0xfd
+#endif
+// event code of the full block. define it in myevents.h if the value
+// collides with other event codes.
+#ifndef EVT_SMPL_BLOCK
+#define EVT_SMPL_BLOCK			0xe2	///< block full
+#endif
+
+/// Modes of Sampler_Send(), combined by OR
+#define SAMPLER_RAW				0x00	///< samples as they are
+#define SAMPLER_DELTA			0x01	///< differences of the samples
+#define SAMPLER_STATS			0x02	///< min, max and mean of the block
+#define SAMPLER_NODATA			0x04	///< no samples, e.g. statistics only
+
+/// Record types of the packets
+#define SAMPLER_REC_RAW			0x00	///< samples
+#define SAMPLER_REC_DELTA		0x01	///< a sample and the differences
+#define SAMPLER_REC_STATS		0x02	///< statistics of the block
+
+/// Sample read function called by the timer
+typedef int16_t (* sampler_read)(void);
+
+/// Statistics of a block
+typedef struct
+{
+	int16_t min;
+	int16_t max;
+	int16_t mean;
+} sampler_stats;
+
+/// Clear the blocks and set the reduction
+void Sampler_Init(uint8_t decim, uint8_t mode);
+/// Take samples by the UsrTimer
+bool Sampler_Start(uint32_t interval, sampler_read f);
+/// Stop the timer
+void Sampler_Stop(void);
+/// Set the destination of the block events
+void Sampler_SetSink(evt_sink sink);
+/// Add a sample
+bool Sampler_Push(int16_t value);
+/// Samples of the block
+int16_t *Sampler_Block(uint8_t index);
+/// Statistics of the block
+void Sampler_Stats(uint8_t index, sampler_stats *stats);
+/// Give the block back to the sampler
+void Sampler_Release(uint8_t index);
+/// Reduce, encode and send the block
+bool Sampler_Send(uint8_t *event);
+/// Number of samples dropped
+uint32_t Sampler_Lost(void);
+
+#endif // __SAMPLER_H
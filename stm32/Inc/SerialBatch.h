@@ -0,0 +1,114 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Batching of small reports into a single serial packet
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * Every packet sent by SerialComm_SendPacket() costs three bytes of framing
+ * (header, length and checksum). When a stream of small reports is sent,
+ * the overhead can take a large portion of the link. This module collects
+ * the reports in a frame buffer and sends them as a single packet when the
+ * frame is full or when BATCH_TIMEOUT has passed since the first report
+ * was added.
+ *
+ * The flush timer does not send the frame from the timer interrupt, where
+ * it could break into a packet being sent by the main loop. It posts an
+ * EVT_BATCH_FLUSH event instead, and the main loop calls
+ * SerialBatch_Flush() to send the frame.
+ *
+ * The payload of a batch packet starts with the BATCH_TAG byte followed by
+ * the records. Each record is one length byte followed by the report
+ * itself (type byte and value bytes), so that the receiver can hand the
+ * report to the handler in place without copying.
+\verbatim
+(BATCH_TAG)(LEN)(TYPE)(VALUE...)(LEN)(TYPE)(VALUE...)...
+\endverbatim
+ * A frame that holds only one report at the time of flush is sent as an
+ * ordinary packet, so SerialBatch_Unpack() accepts both forms.
+ *
+ * While the peer is busy (XOFF received), the frame is kept and the flush
+ * timer asks again later, and SerialBatch_Add() refuses a report if the
+ * frame is full.
+ *
+ * A batch of n reports of s bytes takes n * (s + 1) + 4 bytes on the link
+ * against n * (s + 3) bytes for separate packets, so that batching gains
+ * only when three or more reports fit in a frame, i.e.
+ * MAX_PAYLOAD >= 3 * (s + 1) + 1. For 5-byte reports the default
+ * MAX_PAYLOAD of 10 holds only one, and MAX_PAYLOAD should be raised to 19
+ * or more on both ends of the link (1440 against 1570 report/s at 19 and
+ * 1694 report/s at 32, at 115200 baud, by utils_bench_p19 and
+ * utils_bench_p32).
+ *
+\code
+uint8_t payload[5];
+
+// sender: pack signed int32 value in big endian order
+payload[0] = RPT_S32XXX;
+payload[1] = (value >> 24) & 0xff;
+payload[2] = (value >> 16) & 0xff;
+payload[3] = (value >> 8) & 0xff;
+payload[4] = (value) & 0xff;
+// the report will be sent later with others
+SerialBatch_Add(payload, 5);
+
+// sender main loop
+if(Evt_DeQueue(event))
+{
+	switch(event[0])
+	{
+		case EVT_BATCH_FLUSH:
+			SerialBatch_Flush();
+			break;
+		...
+	}
+}
+
+// receiver: called once for each report in the packet
+void report_handler(uint8_t *report, int size)
+{
+	switch(report[0])
+	{
+		case RPT_S32XXX:
+		...
+	}
+}
+
+if(PKT_RECEIVED == SerialComm_Decoder(new_byte, buffer))
+{
+	SerialBatch_Unpack(buffer, report_handler);
+}
+\endcode
+ */
+
+#ifndef __SERIAL_BATCH_H
+#define __SERIAL_BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SerialComm.h"
+
+/// Flush timeout in UsrTimer ticks counted from the first report of a frame
+#define BATCH_TIMEOUT			20
+/// First payload byte of a batch packet. Reports should not use this type.
+#ifndef BATCH_TAG
+#define BATCH_TAG				0xf9
+#endif
+// event code of the flush timeout. define it in myevents.h if the value
+// collides with other event codes.
+#ifndef EVT_BATCH_FLUSH
+#define EVT_BATCH_FLUSH			0xe3	///< frame due to be sent
+#endif
+
+/// Report handler to be called by SerialBatch_Unpack()
+typedef void (* serialbatch_callback)(uint8_t *report, int size);
+
+/// Initialize the frame buffer
+void SerialBatch_Init(void);
+/// Append a report to the frame
+bool SerialBatch_Add(uint8_t *report, int size);
+/// Send the reports in the frame immediately
+bool SerialBatch_Flush(void);
+/// Split a received packet into reports
+int SerialBatch_Unpack(uint8_t *packet, serialbatch_callback f);
+
+#endif // __SERIAL_BATCH_H
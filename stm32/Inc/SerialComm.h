@@ -9,8 +9,13 @@
 #define __SERIAL_COMM_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
-#define MAX_PAYLOAD			10					///< max size of the payload
+// can be overridden by the project (e.g. -DMAX_PAYLOAD=64), up to 250 bytes.
+// both ends of the link must be built with the same value.
+#ifndef MAX_PAYLOAD
+#define MAX_PAYLOAD		10					///< max size of the payload
+#endif
 #define MAX_PKTSIZE			(MAX_PAYLOAD + 3)   ///< max size of the packet
 #define MAX_DATSIZE			(MAX_PAYLOAD - 1)   ///< max data bytes
 
@@ -18,6 +23,13 @@
 #define PKT_ACK				0xf6				///< ACK packet
 #define PKT_NAK				0xf7				///< NAK packet
 #define PKT_IAM				0xf8                ///< IAM packet
+#define PKT_XOFF			0xf3				///< stop sending packets
+#define PKT_XON				0xf4				///< resume sending packets
+
+/// Time to regard the peer ready without XON in msec (HAL_GetTick)
+#ifndef SERIALCOMM_XOFF_TIMEOUT
+#define SERIALCOMM_XOFF_TIMEOUT	100
+#endif
 
 /// Packet state machine return value
 typedef enum
@@ -28,9 +40,27 @@ typedef enum
 	NAK_RECEIVED,			///< NAK packet received
 	IAM_RECEIVED,           ///< IAM packet received
 	PKT_SIZE_ERR,           ///< packet size error detected
-	PKT_CSUM_ERR			///< checksum error detected
+	PKT_CSUM_ERR,			///< checksum error detected
+	PKT_DROPPED,			///< valid packet dropped for lack of storage
+	XOFF_RECEIVED,			///< XOFF received: the peer is busy
+	XON_RECEIVED			///< XON received: the peer is ready
 } pkt_status;
 
+/// Packet decoding state machine states
+#define PKT_STATE_HDR			0	///< waiting for the header byte
+#define PKT_STATE_LEN			1	///< waiting for the length byte
+#define PKT_STATE_PLD			2	///< collecting the payload
+#define PKT_STATE_CSM			3	///< waiting for the checksum byte
+
+/// Packet decoder state
+typedef struct
+{
+	uint8_t state;			///< state machine state
+	uint8_t index;			///< next position in the packet
+	uint8_t csum;			///< checksum of the payload so far
+	uint8_t *packet;		///< packet storage of MAX_PKTSIZE bytes
+} pkt_decoder;
+
 /// Initialize UART module
 void SerialComm_Init(void) __attribute((weak));
 /// RX interrupt handler
@@ -39,9 +69,21 @@ void SerialComm_RxRoutine(void) __attribute((weak));
 void SerialComm_SendByte(uint8_t byte) __attribute((weak));
 /// Send a stream of bytes
 void SerialComm_SendByteArray(uint8_t *buffer, int size) __attribute((weak));
-/// Send a packet
-void SerialComm_SendPacket(uint8_t *payload, int size);
+/// Send a packet unless the peer is busy
+bool SerialComm_SendPacket(uint8_t *payload, int size);
 /// Packet decoding state machine
 pkt_status SerialComm_Decoder(uint8_t byte, uint8_t *buffer);
+/// Set up a decoder state with the packet storage
+void SerialComm_InitDecoder(pkt_decoder *dec, uint8_t *packet);
+/// Packet decoding state machine assembling the packet in place
+pkt_status SerialComm_Decode(pkt_decoder *dec, uint8_t byte);
+/// Set the busy state and send XOFF / XON
+void SerialComm_SetBusy(bool busy);
+/// Busy state of this end
+bool SerialComm_Busy(void);
+/// Busy state of the peer
+bool SerialComm_PeerBusy(void);
+/// Answer a received packet with ACK or NAK
+void SerialComm_Reply(bool accept);
 
 #endif // __SERIAL_COMM_H
@@ -0,0 +1,128 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Binary trace recorder
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * This program records fixed-size binary records into a ring buffer so that
+ * the order of the timer callbacks, the event queue access and the packet
+ * decoding can be examined after the fact. Each record has a timestamp,
+ * a record type and two arguments. When the buffer is full, the oldest
+ * record is overwritten.
+ *
+ * The recording points are placed in UsrTimer, EvtQueue and SerialComm
+ * through the TRACE() macro, which is compiled only when TRACE_ENABLE is
+ * defined. Otherwise it costs nothing. The application may add its own
+ * records with the type TRC_USER and above.
+ *
+ * The record is written by Trace_Record(), which is inlined at each
+ * recording point so that a record takes only a few stores. The timestamp
+ * is given by TRACE_TIME(), which is HAL_GetTick() by default. For better
+ * resolution and no call at all, define it as a free running hardware
+ * counter, e.g. -D'TRACE_TIME()=(DWT->CYCCNT)' on Cortex-M3/M4.
+ *
+ * Trace_Dump() sends the records over SerialComm, one record per packet,
+ * from the oldest to the newest. The payload is
+\verbatim
+(TRACE_TAG)(TIME:4)(TYPE)(ARG0)(ARG1:2)
+\endverbatim
+ * where multi-byte values are in big endian order. tools/trace2json.py
+ * converts the captured serial stream to the Chrome trace / Perfetto JSON.
+ * While the peer is busy, Trace_Dump() returns false and should be called
+ * again later to send the rest.
+ *
+ * Recording is not protected against the preemption by another interrupt.
+ * If it happens in the middle of a record, one of the two records can be
+ * lost, which is accepted for the sake of speed.
+ */
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Number of records in the ring buffer. Should be a power of 2.
+#define TRACE_DEPTH				64
+/// First payload byte of the dump packet
+#ifndef TRACE_TAG
+#define TRACE_TAG				0xfa
+#endif
+/// Timestamp of the record
+#ifndef TRACE_TIME
+#define TRACE_TIME()			HAL_GetTick()
+extern uint32_t HAL_GetTick(void);
+#endif
+
+#define TRACE_MASK				(TRACE_DEPTH - 1)
+
+/// Record types
+typedef enum
+{
+	TRC_NONE = 0,
+	TRC_TMR_BEGIN,			///< timer callback begins: timer index
+	TRC_TMR_END,			///< timer callback ends: timer index
+	TRC_EVT_ENQ,			///< event posted: event code, queue occupancy
+	TRC_EVT_DROP,			///< event lost: event code
+	TRC_EVT_DEQ,			///< event retrieved: event code, queue occupancy
+	TRC_PKT,				///< decoder result: pkt_status, payload size
+	TRC_USER = 0x80			///< application defined types start here
+} trace_type;
+
+/// Trace record
+typedef struct
+{
+	uint32_t time;
+	uint8_t type;
+	uint8_t arg0;
+	uint16_t arg1;
+} trace_record;
+
+/// Ring buffer of the records
+typedef struct
+{
+	trace_record buff[TRACE_DEPTH];
+	uint32_t head;				///< total number of records
+	uint32_t dump;				///< next record of Trace_Dump()
+	bool dumping;				///< Trace_Dump() in progress
+	volatile bool enable;
+} trace_ring;
+
+extern trace_ring trace;
+
+#ifdef TRACE_ENABLE
+#define TRACE(type, arg0, arg1)	Trace_Record((type), (arg0), (arg1))
+#else
+#define TRACE(type, arg0, arg1)	((void)0)
+#endif
+
+/// Clear the buffer and start recording
+void Trace_Init(void);
+/// Send all the records over SerialComm
+bool Trace_Dump(void);
+
+/**
+ * Write a record at the head of the ring buffer. Use TRACE() macro instead
+ * so that the call can be removed by the build option.
+ *
+ * \param type record type
+ * \param arg0 first argument
+ * \param arg1 second argument
+ */
+static inline void Trace_Record(uint8_t type, uint8_t arg0, uint16_t arg1)
+{
+	trace_record *rec;
+
+	if(!trace.enable)
+	{
+		return;
+	}
+
+	rec = &trace.buff[trace.head++ & TRACE_MASK];
+	rec->time = TRACE_TIME();
+	rec->type = type;
+	rec->arg0 = arg0;
+	rec->arg1 = arg1;
+}
+
+#endif // __TRACE_H
@@ -28,6 +28,11 @@ UsrTimer_Set(10, 5, my_routine);
 \endcode
  * If the duration is zero, then it will run indefinitely.
  *
+ * Only one expired timer is served per tick, to keep the interrupt short.
+ * A routine that must run at every tick, such as the tick of a scheduler,
+ * should be registered by UsrTimer_SetTick() instead of a timer of period
+ * one, which would keep the timers after it from running.
+ *
  */
 #ifndef __USRTIMER_H
 #define __USRTIMER_H
@@ -37,6 +42,7 @@ UsrTimer_Set(10, 5, my_routine);
 #include <stddef.h>
 
 #define MAX_USRTIMER            20	///< maximum number of timers
+#define MAX_USRTICK             4	///< maximum number of tick hooks
 
 typedef void (* usrtimer_callback)(void);
 
@@ -54,5 +60,9 @@ void UsrTimer_Resume(uint32_t index);
 void UsrTimer_Routine(void);
 /// Set a new timer with the callback function
 int UsrTimer_Set(uint32_t interval, uint32_t duration, usrtimer_callback f);
+/// Register a function to be called every tick
+int UsrTimer_SetTick(usrtimer_callback f);
+/// Remove the tick function
+void UsrTimer_ClearTick(int index);
 
 #endif // __USR_TIMER_H
@@ -0,0 +1,258 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "ActObj.h"
+#include "UsrTimer.h"
+#include "IrqLock.h"
+#include "Prof.h"
+
+#if ACT_MAX_OBJ > 32
+#error "ACT_MAX_OBJ should not exceed 32"
+#endif
+
+/// Time event structure
+typedef struct
+{
+	actobj *ao;
+	uint8_t code;
+	uint32_t period;
+	uint32_t duration;
+	uint32_t count;
+} act_tevt;
+
+static struct
+{
+	actobj *table[ACT_MAX_OBJ];		///< objects indexed by priority
+	volatile uint32_t ready;		///< objects with pending events
+	act_tevt tevt[ACT_MAX_TEVT];
+	int tick;						///< tick function index
+} act = { .tick = -1 };
+
+static void ActObj_Tick(void);
+
+/**
+ * Clear all the objects and the time events, then register the time event
+ * routine as a tick function of the UsrTimer.
+ */
+void ActObj_Init(void)
+{
+	unsigned i;
+
+	for(i = 0; i < ACT_MAX_OBJ; i++)
+	{
+		act.table[i] = NULL;
+	}
+	for(i = 0; i < ACT_MAX_TEVT; i++)
+	{
+		act.tevt[i].ao = NULL;
+	}
+	act.ready = 0;
+
+	// time event routine runs every tick
+	if(act.tick >= 0)
+	{
+		UsrTimer_ClearTick(act.tick);
+	}
+	act.tick = UsrTimer_SetTick(ActObj_Tick);
+}
+
+/**
+ * Register the object with its queue storage and the handler. Each object
+ * should have a distinct priority.
+ *
+ * \param  ao active object
+ * \param  prio priority from 0 to ACT_MAX_OBJ - 1, higher value runs first
+ * \param  buff event queue storage
+ * \param  depth number of slots of buff. It can hold depth - 1 events.
+ * \param  handler event handler
+ * \return false if the priority is invalid or already taken
+ */
+bool ActObj_Start(actobj *ao, uint8_t prio, uint8_t (*buff)[EVT_QWIDTH],
+		uint8_t depth, actobj_handler handler)
+{
+	if((prio >= ACT_MAX_OBJ) || (act.table[prio] != NULL) || (depth < 2))
+	{
+		return false;
+	}
+
+	ao->buff = buff;
+	ao->depth = depth;
+	ao->head = ao->tail = 0;
+	ao->prio = prio;
+	ao->handler = handler;
+
+	act.table[prio] = ao;
+
+	return true;
+}
+
+/**
+ * Append the event to the queue of the object and mark the object ready.
+ * If the queue is full, the event is ignored. It can be called from any
+ * interrupt.
+ *
+ * \param  ao active object
+ * \param  event event data in an array of uint8_t
+ * \return false if the queue is full
+ */
+bool ActObj_Post(actobj *ao, uint8_t *event)
+{
+	uint32_t state;
+	uint8_t next;
+	unsigned i;
+
+	// mask all interrupts
+	state = IrqLock_Enter();
+
+	// queue is full
+	next = (ao->head + 1) % ao->depth;
+	if(next == ao->tail)
+	{
+		IrqLock_Exit(state);
+		return false;
+	}
+
+	// copy event bytes into the buffer
+	for(i = 0; i < EVT_QWIDTH; i++)
+	{
+		ao->buff[ao->head][i] = event[i];
+	}
+	// move to the next position
+	ao->head = next;
+	// mark ready
+	act.ready |= (1UL << ao->prio);
+
+	IrqLock_Exit(state);
+
+	return true;
+}
+
+/**
+ * Take the oldest event of the highest priority ready object and call its
+ * handler. Call this function in the main loop.
+ *
+ * \return false if no object is ready
+ */
+bool ActObj_Run(void)
+{
+	uint8_t event[EVT_QWIDTH];
+	uint32_t state;
+	actobj *ao;
+	unsigned i;
+	PROF_ENTER(PROF_ACT_EVENT);
+
+	// nothing to do
+	if(act.ready == 0)
+	{
+		PROF_LEAVE();
+		return false;
+	}
+
+	// mask all interrupts
+	state = IrqLock_Enter();
+
+	// highest priority ready object
+	ao = act.table[31 - __builtin_clz(act.ready)];
+
+	// copy event bytes from the buffer
+	for(i = 0; i < EVT_QWIDTH; i++)
+	{
+		event[i] = ao->buff[ao->tail][i];
+	}
+	// move to the next position
+	ao->tail = (ao->tail + 1) % ao->depth;
+	// queue is empty
+	if(ao->tail == ao->head)
+	{
+		act.ready &= ~(1UL << ao->prio);
+	}
+
+	IrqLock_Exit(state);
+
+	// run to completion
+	ao->handler(event);
+	PROF_LEAVE();
+
+	return true;
+}
+
+/**
+ * Post an event with the code to the object every period. The event data
+ * other than the code is zero.
+ *
+ * \param  ao active object
+ * \param  code event code
+ * \param  period period in UsrTimer ticks
+ * \param  duration number of repetition. 0 for perpetual time event.
+ * \return index of the time event. if failed, -1 will be returned.
+ */
+int ActObj_TimeEvt(actobj *ao, uint8_t code, uint32_t period,
+		uint32_t duration)
+{
+	int i;
+
+	for(i = 0; i < ACT_MAX_TEVT; i++)
+	{
+		if(act.tevt[i].ao == NULL)
+		{
+			act.tevt[i].code = code;
+			act.tevt[i].period = period;
+			act.tevt[i].duration = duration;
+			act.tevt[i].count = 0;
+			// this should come last since the timer checks it
+			act.tevt[i].ao = ao;
+
+			return i;
+		}
+	}
+
+	// no empty slot
+	return -1;
+}
+
+/**
+ * Stop the time event.
+ *
+ * \param index time event index
+ */
+void ActObj_ClearTimeEvt(int index)
+{
+	if((index >= 0) && (index < ACT_MAX_TEVT))
+	{
+		act.tevt[index].ao = NULL;
+	}
+}
+
+/** Time event routine called every UsrTimer tick.
+ */
+static void ActObj_Tick(void)
+{
+	uint8_t event[EVT_QWIDTH] = {0};
+	unsigned i;
+
+	for(i = 0; i < ACT_MAX_TEVT; i++)
+	{
+		if(act.tevt[i].ao == NULL)
+		{
+			continue;
+		}
+
+		// timeout occurred
+		if(++act.tevt[i].count >= act.tevt[i].period)
+		{
+			act.tevt[i].count = 0;
+
+			event[0] = act.tevt[i].code;
+			ActObj_Post(act.tevt[i].ao, event);
+
+			// finite duration
+			if((act.tevt[i].duration > 0) && (--act.tevt[i].duration == 0))
+			{
+				act.tevt[i].ao = NULL;
+			}
+		}
+	}
+}
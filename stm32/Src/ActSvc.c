@@ -0,0 +1,183 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "ActSvc.h"
+#include "PushButton.h"
+#include "EvtPool.h"
+
+// internal event codes
+#define ACTSVC_SIG_SCAN			0x01	///< button scan
+#define ACTSVC_SIG_RXDATA		0x02	///< received bytes: (SIG)(size)(bytes)
+
+/// Maximum number of bytes in a received bytes event
+#define ACTSVC_RX_CHUNK			(EVT_QWIDTH - 2)
+
+#if EVTPOOL_BSIZE < MAX_PKTSIZE
+#error "EVTPOOL_BSIZE should hold a packet of MAX_PKTSIZE bytes"
+#endif
+
+static actobj pbtn_ao;
+static uint8_t pbtn_buff[ACTSVC_QDEPTH][EVT_QWIDTH];
+
+static actobj scom_ao;
+static uint8_t scom_buff[ACTSVC_QDEPTH][EVT_QWIDTH];
+static evt_sink scom_sink;
+static pkt_decoder scom_dec;
+static uint8_t scom_handle;					///< block being decoded into
+static uint8_t scom_scratch[MAX_PKTSIZE];	///< used when the pool is empty
+
+static void ActSvc_PushButton(uint8_t *event);
+static void ActSvc_SerialComm(uint8_t *event);
+
+/**
+ * Initialize PushButton and register it as an active object. The buttons
+ * are scanned every PUSHBTN_TMR_PERIOD by a time event instead of the
+ * UsrTimer callback.
+ *
+ * \param  mask pushbutton mask byte
+ * \param  prio priority of the object
+ * \param  sink destination of the pushbutton events
+ * \return false if the object cannot be started
+ */
+bool ActSvc_InitPushButton(uint8_t mask, uint8_t prio, evt_sink sink)
+{
+	if(!ActObj_Start(&pbtn_ao, prio, pbtn_buff, ACTSVC_QDEPTH,
+				ActSvc_PushButton))
+	{
+		return false;
+	}
+
+	// the scan is driven by the time event
+	PushButton_Init(mask);
+	PushButton_Stop();
+	PushButton_SetSink(sink);
+
+	return ActObj_TimeEvt(&pbtn_ao, ACTSVC_SIG_SCAN, PUSHBTN_TMR_PERIOD, 0)
+		>= 0;
+}
+
+/**
+ * Register the packet decoder as an active object. The packets are decoded
+ * into the blocks of EvtPool, which should be initialized beforehand.
+ *
+ * \param  prio priority of the object
+ * \param  sink destination of the packet events
+ * \return false if the object cannot be started
+ */
+bool ActSvc_InitSerialComm(uint8_t prio, evt_sink sink)
+{
+	scom_sink = sink;
+	scom_handle = 0;
+	SerialComm_InitDecoder(&scom_dec, scom_scratch);
+
+	return ActObj_Start(&scom_ao, prio, scom_buff, ACTSVC_QDEPTH,
+			ActSvc_SerialComm);
+}
+
+/**
+ * Post the received bytes to the SerialComm object. Call this function in
+ * the UART receive callback. The bytes are split into chunks that fit in
+ * an event.
+ *
+ * \param  bytes received bytes
+ * \param  size number of bytes
+ * \return false if the queue of the object is full
+ */
+bool ActSvc_SerialRx(uint8_t *bytes, int size)
+{
+	uint8_t event[EVT_QWIDTH];
+	int i, n;
+
+	while(size > 0)
+	{
+		n = (size > ACTSVC_RX_CHUNK) ? ACTSVC_RX_CHUNK : size;
+
+		event[0] = ACTSVC_SIG_RXDATA;
+		event[1] = (uint8_t)n;
+		for(i = 0; i < n; i++)
+		{
+			event[2 + i] = bytes[i];
+		}
+
+		if(!ActObj_Post(&scom_ao, event))
+		{
+			return false;
+		}
+
+		bytes += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+/** PushButton object handler
+ */
+static void ActSvc_PushButton(uint8_t *event)
+{
+	if(event[0] == ACTSVC_SIG_SCAN)
+	{
+		PushButton_Routine();
+	}
+}
+
+/** Take a pool block for the next packet, or the scratch buffer if the pool
+ * is empty. Called only between packets.
+ */
+static void ActSvc_SerialBlock(void)
+{
+	scom_handle = EvtPool_Alloc();
+	scom_dec.packet = scom_handle ? EvtPool_Data(scom_handle) : scom_scratch;
+}
+
+/** SerialComm object handler
+ */
+static void ActSvc_SerialComm(uint8_t *event)
+{
+	uint8_t out[EVT_QWIDTH] = {0};
+	pkt_status status;
+	int i;
+
+	if(event[0] != ACTSVC_SIG_RXDATA)
+	{
+		return;
+	}
+
+	for(i = 0; i < event[1]; i++)
+	{
+		// retry the pool if the last packet went to the scratch buffer
+		if((scom_handle == 0) && (scom_dec.state == PKT_STATE_HDR))
+		{
+			ActSvc_SerialBlock();
+		}
+
+		status = SerialComm_Decode(&scom_dec, event[2 + i]);
+
+		if(status == PKT_INPROCES)
+		{
+			continue;
+		}
+
+		// the block goes with the event
+		if((status == PKT_RECEIVED) && scom_handle)
+		{
+			out[0] = EVT_SCOM_PACKET;
+			out[1] = scom_handle;
+			if(!scom_sink(out))
+			{
+				EvtPool_Release(scom_handle);
+			}
+			ActSvc_SerialBlock();
+			continue;
+		}
+
+		// report the status
+		out[0] = EVT_SCOM_STATUS;
+		out[1] = (status == PKT_RECEIVED) ? PKT_DROPPED : status;
+
+		scom_sink(out);
+	}
+}
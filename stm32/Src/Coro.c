@@ -0,0 +1,250 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "Coro.h"
+#include "UsrTimer.h"
+#include "ActSvc.h"
+
+static struct
+{
+	coro_task *task[CORO_MAX_TASK];
+	volatile uint32_t ticks;
+	int tick;					///< tick function index
+} coro = { .tick = -1 };
+
+static void Coro_Tick(void);
+
+/**
+ * Clear the task list and register the tick counter as a tick function of
+ * the UsrTimer.
+ */
+void Coro_Init(void)
+{
+	unsigned i;
+
+	for(i = 0; i < CORO_MAX_TASK; i++)
+	{
+		coro.task[i] = NULL;
+	}
+
+	if(coro.tick >= 0)
+	{
+		UsrTimer_ClearTick(coro.tick);
+	}
+	coro.tick = UsrTimer_SetTick(Coro_Tick);
+}
+
+/**
+ * Register the task. The task function runs from the beginning at the next
+ * Coro_Run().
+ *
+ * \param  t task structure
+ * \param  func task function
+ * \return false if the task list is full
+ */
+bool Coro_Start(coro_task *t, coro_func func)
+{
+	unsigned i;
+	int slot = -1;
+
+	for(i = 0; i < CORO_MAX_TASK; i++)
+	{
+		// already registered
+		if(coro.task[i] == t)
+		{
+			slot = i;
+			break;
+		}
+		// empty slot
+		if((slot < 0) && (coro.task[i] == NULL))
+		{
+			slot = i;
+		}
+	}
+
+	if(slot < 0)
+	{
+		return false;
+	}
+
+	t->lc = 0;
+	t->wait = CORO_READY;
+	t->event = NULL;
+	t->func = func;
+	coro.task[slot] = t;
+
+	return true;
+}
+
+/**
+ * Remove the task from the list. Do not call this function inside the task
+ * function; let the function reach CORO_END() instead.
+ *
+ * \param t task structure
+ */
+void Coro_Stop(coro_task *t)
+{
+	unsigned i;
+
+	for(i = 0; i < CORO_MAX_TASK; i++)
+	{
+		if(coro.task[i] == t)
+		{
+			coro.task[i] = NULL;
+		}
+	}
+}
+
+/**
+ * Resume the tasks that are ready or whose deadline has passed. A task that
+ * has finished is removed from the list. Call this function in the main
+ * loop.
+ *
+ * \return true if any task has run
+ */
+bool Coro_Run(void)
+{
+	coro_task *t;
+	bool flag = false;
+	bool run;
+	unsigned i;
+
+	for(i = 0; i < CORO_MAX_TASK; i++)
+	{
+		t = coro.task[i];
+		if(t == NULL)
+		{
+			continue;
+		}
+
+		// ready
+		run = (t->wait == CORO_READY);
+		// deadline passed
+		if(((t->wait == CORO_TICKS) ||
+					(((t->wait == CORO_EVENT) || (t->wait == CORO_PACKET)) &&
+					 (t->deadline != 0))) &&
+				((int32_t)(coro.ticks - t->deadline) >= 0))
+		{
+			run = true;
+		}
+
+		if(run)
+		{
+			t->event = NULL;
+			t->func(t);
+			flag = true;
+		}
+
+		// finished
+		if(t->wait == CORO_DONE)
+		{
+			coro.task[i] = NULL;
+		}
+	}
+
+	return flag;
+}
+
+/**
+ * Resume the tasks waiting for the event code. The event can be the one
+ * retrieved by Evt_DeQueue() or the one delivered to an active object.
+ *
+ * A packet event of the SerialComm object resumes only the first task
+ * waiting for the session, i.e. the first payload byte, and the task takes
+ * over the reference of the block. Tasks waiting for EVT_SCOM_PACKET by
+ * CORO_AWAIT_EVENT() are not resumed by a packet.
+ *
+ * \param  event event data in an array of uint8_t
+ * \return true if any task has taken the event
+ */
+bool Coro_Dispatch(uint8_t *event)
+{
+	coro_task *t;
+	uint8_t *packet = NULL;
+	bool flag = false;
+	unsigned i;
+
+	if((event[0] == EVT_SCOM_PACKET) && event[1])
+	{
+		packet = EvtPool_Data(event[1]);
+	}
+
+	for(i = 0; i < CORO_MAX_TASK; i++)
+	{
+		t = coro.task[i];
+		if(t == NULL)
+		{
+			continue;
+		}
+
+		// the packet goes to one task of the session
+		if(event[0] == EVT_SCOM_PACKET)
+		{
+			if(!packet || flag || (t->wait != CORO_PACKET) ||
+					(packet[1] == 0) || (t->code != packet[2]))
+			{
+				continue;
+			}
+		}
+		else if((t->wait != CORO_EVENT) || (t->code != event[0]))
+		{
+			continue;
+		}
+
+		t->event = event;
+		t->func(t);
+		flag = true;
+
+		// finished
+		if(t->wait == CORO_DONE)
+		{
+			coro.task[i] = NULL;
+		}
+	}
+
+	return flag;
+}
+
+/**
+ * Set the wait condition of the task. The deadline of zero is reserved
+ * for no timeout.
+ *
+ * \param t task structure
+ * \param wait wait state
+ * \param code event code for CORO_EVENT
+ * \param ticks number of ticks to wait, 0 for no timeout for CORO_EVENT
+ */
+void Coro_Wait(coro_task *t, uint8_t wait, uint8_t code, uint32_t ticks)
+{
+	t->wait = wait;
+	t->code = code;
+	t->deadline = 0;
+
+	if(ticks > 0)
+	{
+		t->deadline = coro.ticks + ticks;
+		// zero means no timeout
+		if(t->deadline == 0)
+		{
+			t->deadline = 1;
+		}
+	}
+}
+
+/**
+ * \return tick count since Coro_Init()
+ */
+uint32_t Coro_Ticks(void)
+{
+	return coro.ticks;
+}
+
+/** Tick counter called every UsrTimer tick.
+ */
+static void Coro_Tick(void)
+{
+	coro.ticks++;
+}
@@ -0,0 +1,240 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "EvtPool.h"
+#include "IrqLock.h"
+#include <assert.h>
+#include <stddef.h>
+
+#if EVTPOOL_BLOCKS > 32
+#error "EVTPOOL_BLOCKS should not exceed 32"
+#endif
+
+#define ALL_BLOCKS				((uint32_t)(((uint64_t)1 << EVTPOOL_BLOCKS) - 1))
+
+static struct
+{
+	uint8_t data[EVTPOOL_BLOCKS][EVTPOOL_BSIZE] __attribute__((aligned(4)));
+	uint8_t count[EVTPOOL_BLOCKS];		///< reference count
+	volatile uint32_t free;				///< bit set for each free block
+} pool = { .free = ALL_BLOCKS };
+
+#if defined(__ARM_ARCH_6M__)
+// no exclusive access on ARMv6-M: mask the interrupts instead
+
+/** Clear the lowest bit of the free map and return it, 0 if none */
+static inline uint32_t EvtPool_Take(void)
+{
+	uint32_t state, bit;
+
+	state = IrqLock_Enter();
+	bit = pool.free & (~pool.free + 1);
+	pool.free &= ~bit;
+	IrqLock_Exit(state);
+
+	return bit;
+}
+
+/** Set the bits of the free map */
+static inline void EvtPool_Put(uint32_t bits)
+{
+	uint32_t state;
+
+	state = IrqLock_Enter();
+	pool.free |= bits;
+	IrqLock_Exit(state);
+}
+
+/** Add one to the reference count */
+static inline void EvtPool_Inc(unsigned i)
+{
+	uint32_t state;
+
+	state = IrqLock_Enter();
+	pool.count[i]++;
+	IrqLock_Exit(state);
+}
+
+/** Subtract one from the reference count unless it is zero already.
+ * Return the new count, -1 if it was zero */
+static inline int EvtPool_Dec(unsigned i)
+{
+	uint32_t state;
+	int count = -1;
+
+	state = IrqLock_Enter();
+	if(pool.count[i] > 0)
+	{
+		count = --pool.count[i];
+	}
+	IrqLock_Exit(state);
+
+	return count;
+}
+
+#else
+
+/** Clear the lowest bit of the free map and return it, 0 if none */
+static inline uint32_t EvtPool_Take(void)
+{
+	uint32_t old, bit;
+
+	old = __atomic_load_n(&pool.free, __ATOMIC_ACQUIRE);
+	do
+	{
+		if(old == 0)
+		{
+			return 0;
+		}
+		bit = old & (~old + 1);
+	}
+	while(!__atomic_compare_exchange_n(&pool.free, &old, old & ~bit, true,
+				__ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+	return bit;
+}
+
+/** Set the bits of the free map */
+static inline void EvtPool_Put(uint32_t bits)
+{
+	__atomic_fetch_or(&pool.free, bits, __ATOMIC_RELEASE);
+}
+
+/** Add one to the reference count */
+static inline void EvtPool_Inc(unsigned i)
+{
+	__atomic_add_fetch(&pool.count[i], 1, __ATOMIC_ACQ_REL);
+}
+
+/** Subtract one from the reference count unless it is zero already.
+ * Return the new count, -1 if it was zero */
+static inline int EvtPool_Dec(unsigned i)
+{
+	uint8_t old;
+
+	old = __atomic_load_n(&pool.count[i], __ATOMIC_ACQUIRE);
+	do
+	{
+		if(old == 0)
+		{
+			return -1;
+		}
+	}
+	while(!__atomic_compare_exchange_n(&pool.count[i], &old, old - 1, true,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	return old - 1;
+}
+
+#endif
+
+/**
+ * Return all the blocks to the pool. Outstanding handles become invalid.
+ */
+void EvtPool_Init(void)
+{
+	unsigned i;
+
+	for(i = 0; i < EVTPOOL_BLOCKS; i++)
+	{
+		pool.count[i] = 0;
+	}
+
+	pool.free = ALL_BLOCKS;
+}
+
+/**
+ * Take the lowest free block. The reference count of the block is one.
+ *
+ * \return handle of the block, 0 if the pool is exhausted
+ */
+uint8_t EvtPool_Alloc(void)
+{
+	uint32_t bit;
+
+	bit = EvtPool_Take();
+	if(bit == 0)
+	{
+		return 0;
+	}
+
+	bit = __builtin_ctz(bit);
+	pool.count[bit] = 1;
+
+	return (uint8_t)(bit + 1);
+}
+
+/**
+ * \param  handle handle of the block
+ * \return address of EVTPOOL_BSIZE bytes, NULL for the handle zero
+ */
+uint8_t *EvtPool_Data(uint8_t handle)
+{
+	if((handle == 0) || (handle > EVTPOOL_BLOCKS))
+	{
+		return NULL;
+	}
+
+	return pool.data[handle - 1];
+}
+
+/**
+ * Add a reference for another consumer of the block.
+ *
+ * \param handle handle of the block
+ */
+void EvtPool_Retain(uint8_t handle)
+{
+	if((handle == 0) || (handle > EVTPOOL_BLOCKS))
+	{
+		return;
+	}
+
+	EvtPool_Inc(handle - 1);
+}
+
+/**
+ * Drop a reference. The block returns to the pool with the last one.
+ * Releasing a block that is already free is a fault of the caller: it is
+ * reported by EVTPOOL_FAULT() and otherwise ignored.
+ *
+ * \param  handle handle of the block
+ * \return true if the block is returned to the pool
+ */
+bool EvtPool_Release(uint8_t handle)
+{
+	int count;
+
+	if((handle == 0) || (handle > EVTPOOL_BLOCKS))
+	{
+		return false;
+	}
+
+	count = EvtPool_Dec(handle - 1);
+	// double release
+	if(count < 0)
+	{
+		EVTPOOL_FAULT(handle);
+		return false;
+	}
+
+	// last reference
+	if(count == 0)
+	{
+		EvtPool_Put(1UL << (handle - 1));
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * \return number of free blocks
+ */
+int EvtPool_Free(void)
+{
+	return __builtin_popcount(pool.free);
+}
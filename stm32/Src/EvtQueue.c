@@ -6,17 +6,24 @@
 
 #include "EvtQueue.h"
 #include "UsrTimer.h"
+#include "Trace.h"
+#include "InputRec.h"
 
 extern void HAL_SuspendTick(void);
 extern void HAL_ResumeTick(void);
 
 #define ADVANCE_QPTR(x)     ((x+1) % EVT_QDEPTH)
+#define QUEUE_COUNT()       ((evt_queue.head + EVT_QDEPTH - evt_queue.tail) % EVT_QDEPTH)
 
 static struct
 {
 	uint8_t buff[EVT_QDEPTH][EVT_QWIDTH];
 	uint8_t head;
 	uint8_t tail;
+	uint8_t high;				///< high watermark, 0 if not set
+	uint8_t low;				///< low watermark
+	volatile bool busy;			///< above the high watermark
+	evt_watermark notify;
 } evt_queue;
 
 
@@ -36,6 +43,7 @@ bool Evt_EnQueue(uint8_t *event)
 	if(next == evt_queue.tail)
 	{
 		// event will be lost
+		TRACE(TRC_EVT_DROP, event[0], 0);
 		return false;
 	}
 
@@ -46,6 +54,16 @@ bool Evt_EnQueue(uint8_t *event)
 	}
 	// move to the next positition
 	evt_queue.head = next;
+	TRACE(TRC_EVT_ENQ, event[0], QUEUE_COUNT());
+	// wake up the consumer
+	Evt_Signal();
+
+	// high watermark reached
+	if(evt_queue.high && !evt_queue.busy && (QUEUE_COUNT() >= evt_queue.high))
+	{
+		evt_queue.busy = true;
+		evt_queue.notify(true);
+	}
 
 	return true;
 }
@@ -64,6 +82,7 @@ bool Evt_DeQueue(uint8_t *event)
 {
 	uint8_t i;
 	bool flag = false;
+	bool resume = false;
 
 	// disable all timers
 	UsrTimer_Enable(false);
@@ -78,17 +97,76 @@ bool Evt_DeQueue(uint8_t *event)
 		}
 		// move to the next position
 		evt_queue.tail = ADVANCE_QPTR(evt_queue.tail);
+		TRACE(TRC_EVT_DEQ, event[0], QUEUE_COUNT());
+		INPUTREC_DEQUEUE(event[0]);
 		// set flag
 		flag = true;
+
+		// low watermark reached
+		if(evt_queue.busy && (QUEUE_COUNT() <= evt_queue.low))
+		{
+			evt_queue.busy = false;
+			resume = true;
+		}
 	}
 
 	// enable all timers
 	UsrTimer_Enable(true);
 
+	// notify outside of the critical section
+	if(resume)
+	{
+		evt_queue.notify(false);
+	}
+
 	// return with the flag
 	return flag;
 }
 
+/**
+ * Called whenever a new event is registered. It does nothing by default.
+ * The platform may override it to wake up the consumer waiting for the
+ * event instead of polling Evt_DeQueue().
+ */
+__attribute__((weak)) void Evt_Signal(void)
+{
+}
+
+/**
+ * \return number of events in the queue
+ */
+uint8_t Evt_Count(void)
+{
+	return QUEUE_COUNT();
+}
+
+/**
+ * Call the function with true when the number of events reaches the high
+ * watermark on Evt_EnQueue(), and with false when it falls to the low
+ * watermark on Evt_DeQueue(). The function is called once per transition,
+ * thus it can start and stop a producer such as the serial link:
+\code
+// XOFF at 6 events, XON at 2 events
+Evt_SetWatermark(6, 2, SerialComm_SetBusy);
+\endcode
+ * Since Evt_EnQueue() is called from the timer callbacks, so can be the
+ * function with true. The high watermark should leave room for the events
+ * posted before the producer reacts.
+ *
+ * \param high number of events to call f(true), 0 to disable
+ * \param low number of events to call f(false), less than high
+ * \param f notification function
+ */
+void Evt_SetWatermark(uint8_t high, uint8_t low, evt_watermark f)
+{
+	UsrTimer_Enable(false);
+	evt_queue.notify = f;
+	evt_queue.low = low;
+	evt_queue.busy = false;
+	evt_queue.high = f ? high : 0;
+	UsrTimer_Enable(true);
+}
+
 /**
  * The tail and the head pointers are set to zero. This will invalidate all
  * the data in the queue.
@@ -97,4 +175,11 @@ void Evt_InitQueue(void)
 {
 	// clear queue by resetting the pointers
 	evt_queue.head = evt_queue.tail = 0;
+
+	// the queue is empty now
+	if(evt_queue.busy)
+	{
+		evt_queue.busy = false;
+		evt_queue.notify(false);
+	}
 }
@@ -0,0 +1,190 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "InputRec.h"
+#include "SerialComm.h"
+#include "IrqLock.h"
+
+static struct
+{
+	uint8_t buff[INPUTREC_SIZE];
+	int size;					///< number of bytes recorded
+	int dump;					///< next byte of InputRec_Dump()
+	uint8_t ticks;				///< ticks not recorded yet
+	int16_t button;				///< last recorded button state, -1 if none
+	volatile bool enable;
+	bool overflow;
+} rec;
+
+/**
+ * Clear the buffer and start recording. The system should be in the state
+ * that the replay driver can reproduce, e.g. right after initialization.
+ */
+void InputRec_Start(void)
+{
+	rec.size = 0;
+	rec.dump = 0;
+	rec.ticks = 0;
+	rec.button = -1;
+	rec.overflow = false;
+	rec.enable = true;
+}
+
+/**
+ * Stop recording. The pending ticks are written.
+ */
+void InputRec_Stop(void)
+{
+	// write the pending ticks
+	InputRec_Record(REC_TICKS, 0);
+	rec.enable = false;
+}
+
+/**
+ * Send the records over SerialComm. Recording should be stopped first. If a
+ * packet is refused since the peer is busy, the function returns and the
+ * next call resumes from that packet. Once complete, the next call sends
+ * the records again from the start.
+ *
+ * \return false if the peer is busy and the dump is not complete
+ */
+bool InputRec_Dump(void)
+{
+	uint8_t payload[MAX_PAYLOAD];
+	int i, j, n;
+
+	for(i = rec.dump; i < rec.size; i += n)
+	{
+		// number of bytes in this packet: whole records only
+		n = rec.size - i;
+		if(n > ((MAX_PAYLOAD - 1) & ~1))
+		{
+			n = (MAX_PAYLOAD - 1) & ~1;
+		}
+
+		payload[0] = INPUTREC_TAG;
+		for(j = 0; j < n; j++)
+		{
+			payload[1 + j] = rec.buff[i + j];
+		}
+
+		if(!SerialComm_SendPacket(payload, n + 1))
+		{
+			rec.dump = i;
+			return false;
+		}
+	}
+
+	rec.dump = 0;
+
+	return true;
+}
+
+/**
+ * \return number of bytes recorded
+ */
+int InputRec_Size(void)
+{
+	return rec.size;
+}
+
+/**
+ * \return true if any record was lost because the buffer was full
+ */
+bool InputRec_Overflow(void)
+{
+	return rec.overflow;
+}
+
+/**
+ * Count a tick of UsrTimer_Routine(). Ticks are written as a single record
+ * before the next record or when 255 ticks have passed.
+ */
+void InputRec_Tick(void)
+{
+	if(!rec.enable)
+	{
+		return;
+	}
+
+	if(++rec.ticks == 0xff)
+	{
+		InputRec_Record(REC_TICKS, 0);
+	}
+}
+
+/**
+ * Record the value of PushButton_Read() only when it changes.
+ *
+ * \param value button state
+ */
+void InputRec_Button(uint8_t value)
+{
+	if(rec.button != value)
+	{
+		rec.button = value;
+		InputRec_Record(REC_BUTTON, value);
+	}
+}
+
+/**
+ * Record a byte fed to the decoder. The decoder may run in the main loop,
+ * in the UART interrupt or inside a section of the caller with the timer
+ * disabled, thus the record is made with the interrupts masked, and the
+ * previous state is restored afterwards.
+ *
+ * \param byte received byte
+ */
+void InputRec_Serial(uint8_t byte)
+{
+	uint32_t state = IrqLock_Enter();
+
+	InputRec_Record(REC_SERIAL, byte);
+	IrqLock_Exit(state);
+}
+
+/**
+ * Write a record after the pending ticks. REC_TICKS with the value zero
+ * writes the pending ticks only.
+ *
+ * \param type record type
+ * \param value record value
+ */
+void InputRec_Record(uint8_t type, uint8_t value)
+{
+	if(!rec.enable)
+	{
+		return;
+	}
+
+	// pending ticks first
+	if(rec.ticks > 0)
+	{
+		if(rec.size + 2 > INPUTREC_SIZE)
+		{
+			rec.overflow = true;
+			rec.enable = false;
+			return;
+		}
+		rec.buff[rec.size++] = REC_TICKS;
+		rec.buff[rec.size++] = rec.ticks;
+		rec.ticks = 0;
+	}
+
+	if(type == REC_TICKS)
+	{
+		return;
+	}
+
+	if(rec.size + 2 > INPUTREC_SIZE)
+	{
+		rec.overflow = true;
+		rec.enable = false;
+		return;
+	}
+	rec.buff[rec.size++] = type;
+	rec.buff[rec.size++] = value;
+}
@@ -0,0 +1,39 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "IrqLock.h"
+
+/**
+ * \return PRIMASK before the call
+ */
+__attribute__((weak)) uint32_t IrqLock_Enter(void)
+{
+#if defined(__arm__)
+	uint32_t primask;
+
+	__asm volatile("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+
+	return primask;
+#else
+	// no interrupt on the host: keep the compiler from moving the accesses
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+	return 0;
+#endif
+}
+
+/**
+ * \param state value returned by IrqLock_Enter()
+ */
+__attribute__((weak)) void IrqLock_Exit(uint32_t state)
+{
+#if defined(__arm__)
+	__asm volatile("msr primask, %0" :: "r" (state) : "memory");
+#else
+	(void)state;
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+#endif
+}
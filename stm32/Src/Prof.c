@@ -0,0 +1,223 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "Prof.h"
+#include "SerialComm.h"
+
+#if MAX_PAYLOAD < 10
+#error "MAX_PAYLOAD is too small for the profiler record"
+#endif
+
+#define PROF_MASK				(PROF_BUCKETS - 1)
+
+/// Hash table entry
+typedef struct
+{
+	uint32_t pc;			///< program counter, 0 for an empty entry
+	uint32_t count;			///< number of samples
+} prof_bucket;
+
+static struct
+{
+	prof_bucket table[PROF_BUCKETS];
+	uint32_t act[PROF_MAX_ACT];
+	uint32_t samples;		///< total number of samples
+	uint32_t lost;			///< samples not counted by the table
+	unsigned dump;			///< next record of Prof_Dump()
+	bool dumping;			///< Prof_Dump() in progress
+	bool resume;			///< sampling state before the dump
+	volatile bool enable;
+} prof;
+
+volatile uint8_t prof_activity;
+
+static bool Prof_Send(uint8_t type, uint32_t a, uint32_t b, bool wide);
+
+/**
+ * Clear the histogram and start sampling.
+ */
+void Prof_Init(void)
+{
+	unsigned i;
+
+	prof.enable = false;
+
+	for(i = 0; i < PROF_BUCKETS; i++)
+	{
+		prof.table[i].pc = 0;
+		prof.table[i].count = 0;
+	}
+	for(i = 0; i < PROF_MAX_ACT; i++)
+	{
+		prof.act[i] = 0;
+	}
+	prof.samples = 0;
+	prof.lost = 0;
+	prof.dumping = false;
+
+	prof.enable = true;
+}
+
+/**
+ * Stop sampling. The histogram is kept for Prof_Dump().
+ */
+void Prof_Stop(void)
+{
+	prof.enable = false;
+	prof.resume = false;
+}
+
+/**
+ * Count the current activity. Call this function at every tick.
+ */
+void Prof_Tick(void)
+{
+	Prof_Sample(0);
+}
+
+/**
+ * Count the current activity and the program counter. Called from the
+ * tick interrupt; not reentrant.
+ *
+ * \param pc program counter of the interrupted code, 0 if unknown
+ */
+void Prof_Sample(uint32_t pc)
+{
+	uint32_t h;
+	unsigned i;
+	uint8_t act;
+
+	if(!prof.enable)
+	{
+		return;
+	}
+
+	prof.samples++;
+
+	act = prof_activity;
+	prof.act[(act < PROF_MAX_ACT) ? act : (PROF_MAX_ACT - 1)]++;
+
+	if(pc == 0)
+	{
+		return;
+	}
+
+	// multiplicative hash, ignoring the thumb bit
+	h = ((pc >> 1) * 2654435761u) >> 16;
+
+	// linear probing
+	for(i = 0; i < PROF_PROBE; i++)
+	{
+		prof_bucket *b = &prof.table[(h + i) & PROF_MASK];
+
+		if(b->pc == pc)
+		{
+			b->count++;
+			return;
+		}
+		if(b->pc == 0)
+		{
+			b->pc = pc;
+			b->count = 1;
+			return;
+		}
+	}
+
+	prof.lost++;
+}
+
+/**
+ * Sample the program counter stacked in the exception frame. The frame is
+ * (R0)(R1)(R2)(R3)(R12)(LR)(PC)(xPSR) from the lowest address.
+ *
+ * \param frame stack pointer at the exception entry
+ */
+void Prof_SampleFrame(uint32_t *frame)
+{
+	Prof_Sample(frame[6]);
+}
+
+/**
+ * Send the summary, the activities with samples and the program counters,
+ * one record per packet. Sampling is suspended during the dump and resumes
+ * with the histogram kept. If a packet is refused since the peer is busy,
+ * the function returns with sampling still suspended, and the next call
+ * resumes from that record.
+ *
+ * \return false if the peer is busy and the dump is not complete
+ */
+bool Prof_Dump(void)
+{
+	unsigned i;
+	bool sent;
+
+	if(!prof.dumping)
+	{
+		// suspend sampling
+		prof.resume = prof.enable;
+		prof.enable = false;
+		prof.dumping = true;
+		prof.dump = 0;
+	}
+
+	// the summary, the activities and then the program counters
+	for(; prof.dump < 1 + PROF_MAX_ACT + PROF_BUCKETS; prof.dump++)
+	{
+		i = prof.dump;
+		if(i == 0)
+		{
+			sent = Prof_Send(PROF_REC_SUMMARY, prof.samples, prof.lost, true);
+		}
+		else if(i <= PROF_MAX_ACT)
+		{
+			i -= 1;
+			sent = !prof.act[i] ||
+				Prof_Send(PROF_REC_ACT, i, prof.act[i], false);
+		}
+		else
+		{
+			i -= 1 + PROF_MAX_ACT;
+			sent = !prof.table[i].pc ||
+				Prof_Send(PROF_REC_PC, prof.table[i].pc, prof.table[i].count,
+						true);
+		}
+
+		if(!sent)
+		{
+			return false;
+		}
+	}
+
+	// resume sampling
+	prof.dumping = false;
+	prof.enable = prof.resume;
+
+	return true;
+}
+
+/** Send a record: (PROF_TAG)(type)(a:4 or a:1)(b:4)
+ */
+static bool Prof_Send(uint8_t type, uint32_t a, uint32_t b, bool wide)
+{
+	uint8_t payload[10];
+	int n = 0;
+
+	payload[n++] = PROF_TAG;
+	payload[n++] = type;
+	if(wide)
+	{
+		payload[n++] = (a >> 24) & 0xff;
+		payload[n++] = (a >> 16) & 0xff;
+		payload[n++] = (a >> 8) & 0xff;
+	}
+	payload[n++] = (a) & 0xff;
+	payload[n++] = (b >> 24) & 0xff;
+	payload[n++] = (b >> 16) & 0xff;
+	payload[n++] = (b >> 8) & 0xff;
+	payload[n++] = (b) & 0xff;
+
+	return SerialComm_SendPacket(payload, n);
+}
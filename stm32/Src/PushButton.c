@@ -7,21 +7,118 @@
 #include "PushButton.h"
 #include "EvtQueue.h"
 #include "UsrTimer.h"
+#include "InputRec.h"
 
 typedef struct
 {
 	uint8_t old_state;		///< button state old
 	uint8_t new_state;		///< button state new
+	uint8_t state[8];		///< gesture state
 	uint8_t click[8];		///< number of button click
 	uint8_t duration[8];	///< time passed since last click
+	uint8_t limit[8];		///< timeout of the current state
+	uint8_t repeat[8];		///< current hold repeat interval
 	uint8_t mask;			///< mask for buttons to be ignored
 	uint8_t mode;			///< click mode / updown mode
-	bool flag;				///< internal flag to prevent false detection
+	uint8_t chord[PUSHBTN_MAX_CHORD];	///< button mask of the chords
+	uint8_t chord_on;		///< chords being pressed
+	pushbtn_profile profile[8];	///< detection profile
+	evt_sink sink;			///< destination of the events
+	bool edge;				///< edge-triggered mode
+	int timer;				///< scan timer index in edge-triggered mode
 } pushbtn_param;
 
+/// Gesture states of a button
+enum
+{
+	PBS_IDLE = 0,			///< no gesture in progress
+	PBS_DOWN,				///< pressed
+	PBS_UP,					///< released, waiting for another click
+	PBS_HOLD,				///< held after long click
+	PBS_IGNORE,				///< ignored until released
+	PBS_NUM
+};
+
+/// Inputs to the state machine
+enum
+{
+	PBI_NONE = 0,			///< nothing happened
+	PBI_PRESS,				///< pressed
+	PBI_RELEASE,			///< released
+	PBI_LAST,				///< released with the highest click count
+	PBI_TIMEOUT,			///< timeout of the current state
+	PBI_CHORD,				///< became part of a chord
+	PBI_NUM
+};
+
+/// Actions on the transition
+#define PBA_RESTART				0x01	///< restart the duration count
+#define PBA_COUNT				0x02	///< increase the click count
+#define PBA_CLICK				0x04	///< post the click event
+#define PBA_LONG				0x08	///< post the long click event
+#define PBA_REPEAT				0x10	///< post the repeat event
+
+/// Table entry: next state in the lower 3 bits and actions in the rest
+#define PBT(next, action)		((uint8_t)((next) | ((action) << 3)))
+#define PBT_NEXT(entry)			((entry) & 0x07)
+#define PBT_ACTION(entry)		((entry) >> 3)
+
+/// Transition table indexed by the state and the input
+static const uint8_t pb_table[PBS_NUM][PBI_NUM] =
+{
+	// PBS_IDLE
+	{
+		PBT(PBS_IDLE, 0),
+		PBT(PBS_DOWN, PBA_RESTART),
+		PBT(PBS_IDLE, 0),
+		PBT(PBS_IDLE, 0),
+		PBT(PBS_IDLE, 0),
+		PBT(PBS_IGNORE, 0)
+	},
+	// PBS_DOWN
+	{
+		PBT(PBS_DOWN, 0),
+		PBT(PBS_DOWN, 0),
+		PBT(PBS_UP, PBA_COUNT | PBA_RESTART),
+		PBT(PBS_IDLE, PBA_COUNT | PBA_CLICK),
+		PBT(PBS_HOLD, PBA_LONG | PBA_RESTART),
+		PBT(PBS_IGNORE, 0)
+	},
+	// PBS_UP
+	{
+		PBT(PBS_UP, 0),
+		PBT(PBS_DOWN, PBA_RESTART),
+		PBT(PBS_UP, 0),
+		PBT(PBS_UP, 0),
+		PBT(PBS_IDLE, PBA_CLICK),
+		PBT(PBS_IGNORE, 0)
+	},
+	// PBS_HOLD
+	{
+		PBT(PBS_HOLD, 0),
+		PBT(PBS_HOLD, 0),
+		PBT(PBS_IDLE, 0),
+		PBT(PBS_IDLE, 0),
+		PBT(PBS_HOLD, PBA_REPEAT | PBA_RESTART),
+		PBT(PBS_IGNORE, 0)
+	},
+	// PBS_IGNORE
+	{
+		PBT(PBS_IGNORE, 0),
+		PBT(PBS_IGNORE, 0),
+		PBT(PBS_IDLE, 0),
+		PBT(PBS_IDLE, 0),
+		PBT(PBS_IGNORE, 0),
+		PBT(PBS_IGNORE, 0)
+	}
+};
+
 pushbtn_param pp;
-static void PushButton_Routine(void);
 static void PushButton_ClearLog(uint8_t index);
+static void PushButton_SetLimit(uint8_t index, uint8_t state);
+static void PushButton_Post(uint8_t id, uint8_t code, uint8_t data);
+static void PushButton_EdgeStart(void);
+static void PushButton_EdgeScan(void);
 
 /** Clear the parameter struct and register the main routine to the UserTimer
  * by calling UsrTimer_Set() function. The period of the routine,
@@ -40,16 +137,115 @@ void PushButton_Init(uint8_t mask)
 	pp.old_state = pp.new_state = 0;
 	pp.mask = mask;
 	pp.mode = 0;
-	pp.flag = false;
+	pp.chord_on = 0;
+	pp.sink = Evt_EnQueue;
+	pp.edge = false;
 
-	// clear log
+	// clear log and set default profile
 	for(i = 0; i < 8; i++)
 	{
+		pp.state[i] = PBS_IDLE;
 		PushButton_ClearLog(i);
+		PushButton_SetProfile(i, NULL);
+	}
+
+	// clear chords
+	for(i = 0; i < PUSHBTN_MAX_CHORD; i++)
+	{
+		pp.chord[i] = 0;
 	}
 
 	// register pushbutton main routine
-	UsrTimer_Set(PUSHBTN_TMR_PERIOD, 0, PushButton_Routine);
+	pp.timer = UsrTimer_Set(PUSHBTN_TMR_PERIOD, 0, PushButton_Routine);
+}
+
+/** Same as PushButton_Init() except that the main routine is not registered
+ * until PushButton_Edge() is called. Once started, the main routine runs
+ * every PUSHBTN_TMR_PERIOD as long as any button is pressed or any click
+ * is pending, then the timer is released.
+ *
+ * \param	mask the mask byte that denotes which bit of the uint8_t data
+ * supplied by PushButton_Read() function are assigned to the actual push
+ * button.
+ */
+void PushButton_InitEdge(uint8_t mask)
+{
+	int i ;
+
+	// clear data
+	pp.old_state = pp.new_state = 0;
+	pp.mask = mask;
+	pp.mode = 0;
+	pp.chord_on = 0;
+	pp.sink = Evt_EnQueue;
+	pp.edge = true;
+	pp.timer = -1;
+
+	// clear log and set default profile
+	for(i = 0; i < 8; i++)
+	{
+		pp.state[i] = PBS_IDLE;
+		PushButton_ClearLog(i);
+		PushButton_SetProfile(i, NULL);
+	}
+
+	// clear chords
+	for(i = 0; i < PUSHBTN_MAX_CHORD; i++)
+	{
+		pp.chord[i] = 0;
+	}
+}
+
+/** Call this function from the GPIO EXTI callback of the buttons. The first
+ * scan takes place PUSHBTN_DEBOUNCE after the edge so that the bouncing
+ * settles down. Edges are ignored while the scan is in progress.
+ *
+ * The EXTI interrupt should not preempt the timer interrupt where
+ * UsrTimer_Routine() is located, since both of them access the timer.
+ *
+\code
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	PushButton_Edge();
+}
+\endcode
+ */
+void PushButton_Edge(void)
+{
+	INPUTREC_EDGE();
+
+	// not in edge mode or already scanning
+	if((!pp.edge) || (pp.timer >= 0))
+	{
+		return;
+	}
+
+	// one-shot timer for the first scan
+	pp.timer = UsrTimer_Set(PUSHBTN_DEBOUNCE, 1, PushButton_EdgeStart);
+}
+
+/** Unregister the main routine from the UserTimer so that the caller can run
+ * PushButton_Routine() on its own schedule, every PUSHBTN_TMR_PERIOD.
+ */
+void PushButton_Stop(void)
+{
+	if(pp.timer >= 0)
+	{
+		UsrTimer_Clear(pp.timer);
+	}
+
+	pp.timer = -1;
+	pp.edge = false;
+}
+
+/** The events are posted by Evt_EnQueue() by default. They can be directed
+ * to another destination such as an active object.
+ *
+ * \param sink event destination, NULL for Evt_EnQueue()
+ */
+void PushButton_SetSink(evt_sink sink)
+{
+	pp.sink = sink ? sink : Evt_EnQueue;
 }
 
 /** In CLICK mode, the change of the button state is detected. In UDOWN mode
@@ -57,27 +253,91 @@ void PushButton_Init(uint8_t mask)
  *
  * \param mode either PUSHBTN_MODE_CLICK or PUSHBTN_MODE_UDOWN
  * \param flag true if the button whose mode is changes is currently being
- *			pressed.
+ *			pressed. Otherwise the buttons pressed at the moment are ignored
+ *			until released, as PushButtonWide_SetMode() does.
  */
 void PushButton_SetMode(uint8_t mode, bool flag)
 {
+	uint8_t pressed = pp.new_state & pp.mask;
 	int i;
 
 	// clear data
 	pp.old_state = pp.new_state = 0;
-	// this looks weird but correct
-	pp.flag = !flag;
 
 	// clear log
 	for(i = 0; i < 8; i++)
 	{
 		PushButton_ClearLog(i);
+		// this looks weird but correct: the next release of a button being
+		// pressed will be ignored
+		pp.state[i] = (!flag && ((pressed >> i) & 0x01)) ? PBS_IGNORE
+			: PBS_IDLE;
 	}
 
 	// change mode
 	pp.mode = mode;
 }
 
+/** Set the gestures to be detected and their thresholds for the button.
+ * If max_click of the profile is 1, single click is reported as soon as the
+ * button is released. Likewise double click is reported on the second
+ * release if max_click is 2. Long click is not detected if to_long is 0,
+ * in which case a long press is regarded as a click when released.
+ *
+ * If to_repeat is not zero,
+ * PBTN_RPT is posted while the button is held after a long click. The
+ * interval starts at to_repeat and is shortened by a quarter at each
+ * repeat down to repeat_min.
+ *
+ * The profile is reset to the default by PushButton_Init(), thus this
+ * function should be called after it.
+ *
+ * \param index button index (0 to 7)
+ * \param profile detection profile, NULL for the default profile
+ */
+void PushButton_SetProfile(uint8_t index, const pushbtn_profile *profile)
+{
+	if(index >= 8)
+	{
+		return;
+	}
+
+	if(profile)
+	{
+		pp.profile[index] = *profile;
+		// at least single click should be detected
+		if(pp.profile[index].max_click == 0)
+		{
+			pp.profile[index].max_click = 1;
+		}
+	}
+	else
+	{
+		pp.profile[index].max_click = 3;
+		pp.profile[index].to_short = PUSHBTN_TO_SHORT;
+		pp.profile[index].to_long = PUSHBTN_TO_LONG;
+		pp.profile[index].to_repeat = 0;
+		pp.profile[index].repeat_min = 0;
+	}
+}
+
+/** A chord is reported when all the buttons of the chord are pressed
+ * together. The event data is (EVT_PBTN_INPUT)(index + 1)(PBTN_CHRD)(mask).
+ * The buttons of the chord do not report their own events until they are
+ * released.
+ *
+ * \param index chord index (0 to PUSHBTN_MAX_CHORD - 1)
+ * \param mask buttons of the chord, 0 to remove the chord
+ */
+void PushButton_SetChord(uint8_t index, uint8_t mask)
+{
+	if(index < PUSHBTN_MAX_CHORD)
+	{
+		pp.chord[index] = mask;
+		pp.chord_on &= ~(1 << index);
+	}
+}
+
 /** Clear the duration parameter and the click count parameter of the button.
  */
 void PushButton_ClearLog(uint8_t index)
@@ -88,19 +348,148 @@ void PushButton_ClearLog(uint8_t index)
 	}
 }
 
+/** True if no button is pressed and no click is pending.
+ */
+static bool PushButton_Idle(void)
+{
+	int i;
+
+	// any button pressed
+	if(pp.new_state & pp.mask)
+	{
+		return false;
+	}
+
+	// any gesture in progress. the buttons waiting for the release to be
+	// ignored are not pressed at this point
+	for(i = 0; i < 8; i++)
+	{
+		if((pp.state[i] != PBS_IDLE) && (pp.state[i] != PBS_IGNORE))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/** First scan after the edge. The one-shot timer of this callback is cleared
+ * by UsrTimer_Routine() after the call.
+ */
+static void PushButton_EdgeStart(void)
+{
+	PushButton_Routine();
+
+	// false trigger or quick release
+	if(PushButton_Idle())
+	{
+		pp.timer = -1;
+	}
+	// continue scanning while the gesture is in progress
+	else
+	{
+		pp.timer = UsrTimer_Set(PUSHBTN_TMR_PERIOD, 0, PushButton_EdgeScan);
+	}
+}
+
+/** Periodic scan in edge mode. The timer is released when all buttons are
+ * idle.
+ */
+static void PushButton_EdgeScan(void)
+{
+	PushButton_Routine();
+
+	if(PushButton_Idle())
+	{
+		UsrTimer_Clear(pp.timer);
+		pp.timer = -1;
+	}
+}
+
+/** Set the timeout of the state in number of scans. PUSHBTN_TO_MAX means
+ * no timeout since the duration count saturates there.
+ */
+static void PushButton_SetLimit(uint8_t index, uint8_t state)
+{
+	uint8_t limit = PUSHBTN_TO_MAX;
+
+	// long click
+	if((state == PBS_DOWN) && (pp.profile[index].to_long > 0))
+	{
+		limit = pp.profile[index].to_long;
+	}
+	// multi-click window
+	else if(state == PBS_UP)
+	{
+		limit = pp.profile[index].to_short;
+	}
+	// hold repeat
+	else if((state == PBS_HOLD) && (pp.repeat[index] > 0))
+	{
+		limit = pp.repeat[index];
+	}
+
+	pp.limit[index] = limit;
+}
+
+/** Post a pushbutton event: (EVT_PBTN_INPUT)(id)(code)(data)
+ */
+static void PushButton_Post(uint8_t id, uint8_t code, uint8_t data)
+{
+	uint8_t event[EVT_QWIDTH];
+
+	event[0] = EVT_PBTN_INPUT;
+	event[1] = id;
+	event[2] = code;
+	event[3] = data;
+
+	pp.sink(event);
+}
+
 /** Main routine
  */
 void PushButton_Routine()
 {
 	int i;
 	uint8_t diff_state;
+	uint8_t chord_state;
+	uint8_t pressed, input, entry, next, action;
 	uint8_t event[EVT_QWIDTH];
 
 	pp.new_state = PushButton_Read();
+	INPUTREC_BUTTON(pp.new_state);
 
 	// difference in the button state
 	diff_state = pp.old_state ^ pp.new_state;
 
+	// chords
+	chord_state = 0;
+	for(i = 0; i < PUSHBTN_MAX_CHORD; i++)
+	{
+		if(pp.chord[i] == 0)
+		{
+			continue;
+		}
+
+		// all buttons of the chord are pressed
+		if((pp.new_state & pp.chord[i]) == pp.chord[i])
+		{
+			// report only once until released
+			if(((pp.chord_on >> i) & 0x01) == 0x00)
+			{
+				PushButton_Post(i + 1, PBTN_CHRD, pp.chord[i]);
+				pp.chord_on |= (1 << i);
+				// the buttons will not report their own events
+				chord_state |= pp.chord[i];
+			}
+		}
+		// all buttons of the chord are released
+		else if((pp.new_state & pp.chord[i]) == 0)
+		{
+			pp.chord_on &= ~(1 << i);
+		}
+	}
+
 	for(i = 0; i < 8; i++)
 	{
 		// skip if no button is assigned
@@ -120,7 +509,7 @@ void PushButton_Routine()
 				event[2] = PBTN_DOWN;
 	
 				// post the event as long as the button is pressed down
-				Evt_EnQueue(event);
+				pp.sink(event);
 			}
 			// button released
 			else
@@ -133,102 +522,123 @@ void PushButton_Routine()
 					event[2] = PBTN_ENDN;
 	
 					// post the event to indicate the end of the down state
-					Evt_EnQueue(event);
+					pp.sink(event);
 				}
 			}
 		}
 		// click mode
 		else
 		{
-			// the button state changed
-			if((diff_state >> i) & 0x01)
+			pressed = (pp.new_state >> i) & 0x01;
+
+			// button state not changed: increase duration count
+			if((((diff_state >> i) & 0x01) == 0x00) &&
+					(pp.duration[i] > 0) && (pp.duration[i] < PUSHBTN_TO_MAX))
 			{
-				// (re)start duration count
-				pp.duration[i] = 1;
-	
-				// the button released
-				if(((pp.new_state >> i) & 0x01) == 0x00)
-				{
-					if(pp.flag)
-					{
-						pp.flag = false;
-						//
-						pp.duration[i] = 0;
-					}
-					else
-					{
-						// increase click count
-						pp.click[i]++;
-					}
-				}
+				pp.duration[i]++;
 			}
-			// button state not changed
-			else
+
+			// classify the input
+			if((chord_state >> i) & 0x01)
 			{
-				// increase duration count
-				if((pp.duration[i] > 0) && 
-						(pp.duration[i] < PUSHBTN_TO_MAX))
+				input = PBI_CHORD;
+			}
+			else if((diff_state >> i) & 0x01)
+			{
+				if(pressed)
+				{
+					input = PBI_PRESS;
+				}
+				// the highest click count is reached by this release
+				else if(pp.click[i] + 1 >= pp.profile[i].max_click)
+				{
+					input = PBI_LAST;
+				}
+				else
 				{
-					pp.duration[i]++;
+					input = PBI_RELEASE;
 				}
 			}
-	
-			// triple click
-			if(pp.click[i] >= 3)
+			else if(pp.duration[i] > pp.limit[i])
 			{
-				// triple click event
-				event[0] = EVT_PBTN_INPUT;
-				event[1] = (uint8_t)(i+1);
-				event[2] = PBTN_TCLK;
-				// post event
-				Evt_EnQueue(event);
-	
-				// clear log
-				PushButton_ClearLog(i);
+				input = PBI_TIMEOUT;
 			}
-			// button relased and short timeout passed
-			else if((pp.duration[i] > PUSHBTN_TO_SHORT) && 
-					(((pp.new_state >> i) & 0x01) == 0x00))
+			else
 			{
-				event[0] = EVT_PBTN_INPUT;
-				event[1] = (uint8_t)(i+1);
+				input = PBI_NONE;
+			}
+
+			// state transition
+			entry = pb_table[pp.state[i]][input];
+			next = PBT_NEXT(entry);
+			action = PBT_ACTION(entry);
+
+			// nothing to do
+			if((action == 0) && (next == pp.state[i]))
+			{
+				continue;
+			}
 
-				// double click
-				if(pp.click[i] == 2)
+			// count the click
+			if((action & PBA_COUNT) && (pp.click[i] < PUSHBTN_TO_MAX))
+			{
+				pp.click[i]++;
+			}
+			// click sequence completed
+			if(action & PBA_CLICK)
+			{
+				if(pp.click[i] >= 4)
+				{
+					PushButton_Post(i + 1, PBTN_NCLK, pp.click[i]);
+				}
+				else if(pp.click[i] == 3)
+				{
+					PushButton_Post(i + 1, PBTN_TCLK, pp.click[i]);
+				}
+				else if(pp.click[i] == 2)
 				{
-					// double click event
-					event[2] = PBTN_DCLK;
+					PushButton_Post(i + 1, PBTN_DCLK, pp.click[i]);
 				}
-				// single click
 				else
 				{
-					// single click event
-					event[2] = PBTN_SCLK;
+					PushButton_Post(i + 1, PBTN_SCLK, 1);
 				}
-				// post the event
-				Evt_EnQueue(event);
+			}
+			// long click
+			if(action & PBA_LONG)
+			{
+				PushButton_Post(i + 1, PBTN_LCLK, 0);
+				// first repeat interval
+				pp.repeat[i] = pp.profile[i].to_repeat;
+			}
+			// hold repeat
+			if(action & PBA_REPEAT)
+			{
+				PushButton_Post(i + 1, PBTN_RPT, pp.repeat[i]);
+				// shorten the interval by a quarter down to repeat_min
+				if(pp.repeat[i] > pp.profile[i].repeat_min)
+				{
+					pp.repeat[i] -= (pp.repeat[i] >> 2) ? (pp.repeat[i] >> 2) : 1;
+					if(pp.repeat[i] < pp.profile[i].repeat_min)
+					{
+						pp.repeat[i] = pp.profile[i].repeat_min;
+					}
+				}
+			}
 
-				// clear log
+			// clear log when the click sequence is over
+			if((next != PBS_DOWN) && (next != PBS_UP))
+			{
 				PushButton_ClearLog(i);
 			}
-			// button pressed and long timeout passed
-			else if((pp.duration[i] > PUSHBTN_TO_LONG) && 
-					(((pp.new_state >> i) & 0x01) == 0x01))
+			// (re)start duration count with the timeout of the next state
+			if(action & PBA_RESTART)
 			{
-				// long click event
-				event[0] = EVT_PBTN_INPUT;
-				event[1] = (uint8_t)(i+1);
-				event[2] = PBTN_LCLK;
-	
-				// post the event
-				Evt_EnQueue(event);
-	
-				// clear log
-				PushButton_ClearLog(i);
-	
-				// raise flag: this will prevent false detect after long click
-				pp.flag = true;
+				pp.duration[i] = 1;
+				PushButton_SetLimit(i, next);
 			}
+
+			pp.state[i] = next;
 		}
 	}
 	// update pin state
@@ -0,0 +1,251 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "PushButtonWide.h"
+#include "EvtQueue.h"
+#include "UsrTimer.h"
+
+#if PUSHBTNW_TO_LONG + 1 >= (1 << PUSHBTNW_DUR_BITS)
+#error "PUSHBTNW_DUR_BITS is too small for PUSHBTNW_TO_LONG"
+#endif
+
+#if PUSHBTNW_WIDTH == 64
+#define PUSHBTNW_CTZ(x)			__builtin_ctzll(x)
+#else
+#define PUSHBTNW_CTZ(x)			__builtin_ctz(x)
+#endif
+
+/// PBTN_DOWN repetition in number of scans
+#define PUSHBTNW_UDOWN_DIV		(PUSHBTN_TMR_PERIOD / PUSHBTNW_TMR_PERIOD)
+
+typedef struct
+{
+	pushbtnw_t state;						///< debounced button state
+	pushbtnw_t ct0;							///< debounce counter bit 0
+	pushbtnw_t ct1;							///< debounce counter bit 1
+	pushbtnw_t dur[PUSHBTNW_DUR_BITS];		///< time passed since last click
+	pushbtnw_t clk0;						///< click count bit 0
+	pushbtnw_t clk1;						///< click count bit 1
+	pushbtnw_t mask;						///< mask for buttons to be ignored
+	pushbtnw_t mode;						///< click mode / updown mode
+	pushbtnw_t flag;						///< prevent false detection
+	uint8_t tick;							///< scan count for PBTN_DOWN
+	evt_sink sink;							///< destination of the events
+} pushbtnw_param;
+
+static pushbtnw_param pw;
+static void PushButtonWide_Clear(pushbtnw_t bits);
+static void PushButtonWide_Post(pushbtnw_t bits, uint8_t code);
+static inline pushbtnw_t PushButtonWide_Greater(unsigned value);
+
+/** Clear the parameter struct and register the main routine to the UserTimer
+ * by calling UsrTimer_Set() function.
+ *
+ * \param	mask the mask word that denotes which bit of the data supplied by
+ * PushButtonWide_Read() function are assigned to the actual push button.
+ */
+void PushButtonWide_Init(pushbtnw_t mask)
+{
+	// clear data
+	pw.state = 0;
+	pw.ct0 = pw.ct1 = ~(pushbtnw_t)0;
+	pw.mask = mask;
+	pw.mode = 0;
+	pw.flag = 0;
+	pw.tick = 0;
+	pw.sink = Evt_EnQueue;
+
+	// clear log
+	PushButtonWide_Clear(~(pushbtnw_t)0);
+
+	// register pushbutton main routine
+	UsrTimer_Set(PUSHBTNW_TMR_PERIOD, 0, PushButtonWide_Routine);
+}
+
+/** The events are posted by Evt_EnQueue() by default. They can be directed
+ * to another destination such as an active object.
+ *
+ * \param sink event destination, NULL for Evt_EnQueue()
+ */
+void PushButtonWide_SetSink(evt_sink sink)
+{
+	pw.sink = sink ? sink : Evt_EnQueue;
+}
+
+/** Each bit of the mode word sets the mode of the corresponding button to
+ * either PUSHBTN_MODE_CLICK(0) or PUSHBTN_MODE_UDOWN(1).
+ *
+ * \param mode mode word
+ * \param pressed buttons currently being pressed. The next release of
+ *			these buttons will be ignored.
+ */
+void PushButtonWide_SetMode(pushbtnw_t mode, pushbtnw_t pressed)
+{
+	// clear log
+	PushButtonWide_Clear(~(pushbtnw_t)0);
+
+	pw.flag = pressed & ~mode & pw.mask;
+	// change mode
+	pw.mode = mode;
+}
+
+/** Main routine
+ */
+void PushButtonWide_Routine(void)
+{
+	pushbtnw_t diff, old, rel, nz, sat, inc, carry, t;
+	pushbtnw_t gt_short, gt_long;
+	pushbtnw_t tclk, dclk, sclk, lclk;
+	int b;
+
+	// debounce: the counter of a button whose reading differs from the
+	// debounced state counts down from 3 and the state toggles at roll over
+	diff = pw.state ^ (PushButtonWide_Read() & pw.mask);
+	pw.ct0 = ~(pw.ct0 & diff);
+	pw.ct1 = pw.ct0 ^ (pw.ct1 & diff);
+	diff &= pw.ct0 & pw.ct1;
+
+	old = pw.state;
+	pw.state ^= diff;
+	rel = ~pw.state;
+
+	// up-down mode
+	if(++pw.tick >= PUSHBTNW_UDOWN_DIV)
+	{
+		pw.tick = 0;
+		PushButtonWide_Post(pw.state & pw.mode, PBTN_DOWN);
+	}
+	else
+	{
+		PushButtonWide_Post(diff & pw.state & pw.mode, PBTN_DOWN);
+	}
+	PushButtonWide_Post(old & rel & pw.mode, PBTN_ENDN);
+
+	// click mode
+	diff &= ~pw.mode;
+
+	// running and not saturated duration counters
+	nz = 0;
+	sat = ~(pushbtnw_t)0;
+	for(b = 0; b < PUSHBTNW_DUR_BITS; b++)
+	{
+		nz |= pw.dur[b];
+		sat &= pw.dur[b];
+	}
+	inc = nz & ~sat & ~diff;
+
+	// increase duration count
+	carry = inc;
+	for(b = 0; b < PUSHBTNW_DUR_BITS; b++)
+	{
+		t = pw.dur[b] & carry;
+		pw.dur[b] ^= carry;
+		carry = t;
+	}
+
+	// (re)start duration count of the changed buttons
+	pw.dur[0] |= diff;
+	for(b = 1; b < PUSHBTNW_DUR_BITS; b++)
+	{
+		pw.dur[b] &= ~diff;
+	}
+
+	// released buttons: ignore if flagged, otherwise count the click
+	diff &= rel;
+	t = diff & pw.flag;
+	pw.dur[0] &= ~t;
+	pw.flag &= ~t;
+	diff &= ~t;
+	t = pw.clk0 & diff;
+	pw.clk0 ^= diff;
+	pw.clk1 |= t;
+
+	// compare the duration counters with the timeouts
+	gt_short = PushButtonWide_Greater(PUSHBTNW_TO_SHORT);
+	gt_long = PushButtonWide_Greater(PUSHBTNW_TO_LONG);
+
+	// triple click
+	tclk = pw.clk0 & pw.clk1;
+	// button released and short timeout passed
+	sclk = gt_short & rel & ~tclk;
+	// double click
+	dclk = sclk & pw.clk1 & ~pw.clk0;
+	// single click
+	sclk &= ~dclk;
+	// button pressed and long timeout passed
+	lclk = gt_long & pw.state & ~tclk;
+
+	PushButtonWide_Post(tclk, PBTN_TCLK);
+	PushButtonWide_Post(dclk, PBTN_DCLK);
+	PushButtonWide_Post(sclk, PBTN_SCLK);
+	PushButtonWide_Post(lclk, PBTN_LCLK);
+
+	// clear log
+	PushButtonWide_Clear(tclk | dclk | sclk | lclk);
+
+	// raise flag: this will prevent false detect after long click
+	pw.flag |= lclk;
+}
+
+/** Clear the duration and the click count of the buttons.
+ */
+static void PushButtonWide_Clear(pushbtnw_t bits)
+{
+	int b;
+
+	for(b = 0; b < PUSHBTNW_DUR_BITS; b++)
+	{
+		pw.dur[b] &= ~bits;
+	}
+	pw.clk0 &= ~bits;
+	pw.clk1 &= ~bits;
+}
+
+/** Bit-serial comparison of all duration counters with a constant, from
+ * the most significant bit. It is unrolled by the compiler since the value
+ * is a constant.
+ *
+ * \return buttons whose duration count is greater than the value
+ */
+static inline pushbtnw_t PushButtonWide_Greater(unsigned value)
+{
+	pushbtnw_t gt = 0;
+	pushbtnw_t eq = ~(pushbtnw_t)0;
+	int b;
+
+	for(b = PUSHBTNW_DUR_BITS - 1; b >= 0; b--)
+	{
+		if((value >> b) & 0x01)
+		{
+			eq &= pw.dur[b];
+		}
+		else
+		{
+			gt |= eq & pw.dur[b];
+			eq &= ~pw.dur[b];
+		}
+	}
+
+	return gt;
+}
+
+/** Post an event for each button of the bit set.
+ */
+static void PushButtonWide_Post(pushbtnw_t bits, uint8_t code)
+{
+	uint8_t event[EVT_QWIDTH];
+
+	event[0] = EVT_PBTN_INPUT;
+	event[2] = code;
+
+	while(bits)
+	{
+		event[1] = (uint8_t)(PUSHBTNW_CTZ(bits) + PUSHBTNW_ID_BASE);
+		pw.sink(event);
+		// clear the lowest set bit
+		bits &= bits - 1;
+	}
+}
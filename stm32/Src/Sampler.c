@@ -0,0 +1,368 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "Sampler.h"
+#include "SerialComm.h"
+#include "UsrTimer.h"
+
+/// Header bytes of a sample packet: tag, record type and sequence
+#define SAMPLER_HDR				3
+
+#if MAX_PAYLOAD < SAMPLER_HDR + 6
+#error "MAX_PAYLOAD should hold the statistics packet"
+#endif
+
+static struct
+{
+	int16_t block[2][SAMPLER_BLOCK];
+	uint8_t fill;				///< block being filled
+	int count;					///< number of samples in the block
+	volatile bool held[2];		///< block given to the consumer
+	uint8_t seq;				///< sequence number of the next block
+	volatile uint32_t lost;		///< number of samples dropped
+	uint8_t decim;				///< decimation factor
+	uint8_t mode;				///< SAMPLER_DELTA, SAMPLER_STATS, ...
+	evt_sink sink;				///< destination of the events
+	sampler_read read;			///< read function of the timer
+	int timer;					///< sampling timer index, -1 if not running
+} smp = { .timer = -1 };
+
+/// Progress of Sampler_Send()
+static struct
+{
+	bool active;				///< a block is being sent
+	uint8_t index;				///< block index
+	uint8_t seq;				///< block sequence number
+	bool stats;					///< statistics packet to be sent
+	sampler_stats st;			///< statistics before decimation
+	int count;					///< number of samples after decimation
+	int pos;					///< next sample to be sent
+	int16_t *data;				///< samples to be sent
+	int16_t out[SAMPLER_BLOCK];	///< decimated samples
+} tx;
+
+static void Sampler_Timer(void);
+static int16_t *Sampler_Decimate(const int16_t *block);
+static int Sampler_Encode(uint8_t *payload, int *n);
+
+/**
+ * The blocks are emptied and the sampling timer is stopped if any. The
+ * events are posted by Evt_EnQueue() until Sampler_SetSink() is called.
+ *
+ * \param decim decimation factor, 1 or 0 for none
+ * \param mode SAMPLER_RAW or SAMPLER_DELTA, with SAMPLER_STATS and
+ *        SAMPLER_NODATA
+ */
+void Sampler_Init(uint8_t decim, uint8_t mode)
+{
+	Sampler_Stop();
+
+	smp.fill = 0;
+	smp.count = 0;
+	smp.held[0] = smp.held[1] = false;
+	smp.seq = 0;
+	smp.lost = 0;
+	smp.decim = decim ? decim : 1;
+	smp.mode = mode;
+	smp.sink = Evt_EnQueue;
+	smp.read = NULL;
+
+	tx.active = false;
+}
+
+/**
+ * Start a UsrTimer that calls the read function and adds the value by
+ * Sampler_Push(). The previous timer is cleared if any.
+ *
+ * \param  interval sampling interval in ticks
+ * \param  f read function
+ * \return false if no timer is available
+ */
+bool Sampler_Start(uint32_t interval, sampler_read f)
+{
+	Sampler_Stop();
+
+	smp.read = f;
+	smp.timer = UsrTimer_Set(interval, 0, Sampler_Timer);
+
+	return smp.timer >= 0;
+}
+
+/**
+ * Stop the sampling timer. The samples in the current block are kept.
+ */
+void Sampler_Stop(void)
+{
+	if(smp.timer >= 0)
+	{
+		UsrTimer_Clear(smp.timer);
+	}
+
+	smp.timer = -1;
+}
+
+/** The events are posted by Evt_EnQueue() by default. They can be directed
+ * to another destination such as an active object.
+ *
+ * \param sink event destination, NULL for Evt_EnQueue()
+ */
+void Sampler_SetSink(evt_sink sink)
+{
+	smp.sink = sink ? sink : Evt_EnQueue;
+}
+
+/**
+ * Add a sample to the current block. When the block is full, the event is
+ * posted and the other block is taken. If the event is refused, the block
+ * is discarded and filled again.
+ *
+ * \param  value sample
+ * \return false if the sample is dropped since the block is still held by
+ *         the consumer
+ */
+bool Sampler_Push(int16_t value)
+{
+	uint8_t event[EVT_QWIDTH] = {0};
+
+	if(smp.held[smp.fill])
+	{
+		smp.lost++;
+		return false;
+	}
+
+	smp.block[smp.fill][smp.count++] = value;
+	if(smp.count < SAMPLER_BLOCK)
+	{
+		return true;
+	}
+
+	// the block goes to the consumer
+	smp.held[smp.fill] = true;
+	event[0] = EVT_SMPL_BLOCK;
+	event[1] = smp.fill;
+	event[2] = smp.seq++;
+	if(!smp.sink(event))
+	{
+		smp.held[smp.fill] = false;
+		smp.lost += SAMPLER_BLOCK;
+	}
+
+	smp.fill ^= 1;
+	smp.count = 0;
+
+	return true;
+}
+
+/**
+ * \param  index block index of the event
+ * \return samples of the block
+ */
+int16_t *Sampler_Block(uint8_t index)
+{
+	return smp.block[index & 1];
+}
+
+/**
+ * Find the minimum, the maximum and the mean of the block. The samples are
+ * left as they are by Sampler_Send().
+ *
+ * \param index block index of the event
+ * \param stats statistics
+ */
+void Sampler_Stats(uint8_t index, sampler_stats *stats)
+{
+	int16_t *block = smp.block[index & 1];
+	int32_t sum = 0;
+	int i;
+
+	stats->min = stats->max = block[0];
+	for(i = 0; i < SAMPLER_BLOCK; i++)
+	{
+		if(block[i] < stats->min)
+		{
+			stats->min = block[i];
+		}
+		if(block[i] > stats->max)
+		{
+			stats->max = block[i];
+		}
+		sum += block[i];
+	}
+
+	stats->mean = (int16_t)(sum / SAMPLER_BLOCK);
+}
+
+/**
+ * Give the block back so that it can be filled again.
+ *
+ * \param index block index of the event
+ */
+void Sampler_Release(uint8_t index)
+{
+	smp.held[index & 1] = false;
+}
+
+/**
+ * Decimate the block, send the packets according to the mode and release
+ * the block. If a packet is refused since the peer is busy, the function
+ * returns and resumes from that packet when called again with the same
+ * event. A different event abandons the block in progress, which should
+ * then be released by the caller or sent again from the start. The block
+ * itself is not modified, since it is decimated into a separate buffer.
+ *
+ * \param  event block event
+ * \return false if the peer is busy and the block is not sent completely
+ */
+bool Sampler_Send(uint8_t *event)
+{
+	uint8_t payload[MAX_PAYLOAD];
+	int size, n;
+
+	// new block
+	if(!tx.active || (tx.index != (event[1] & 1)) || (tx.seq != event[2]))
+	{
+		tx.active = true;
+		tx.index = event[1] & 1;
+		tx.seq = event[2];
+		tx.stats = (smp.mode & SAMPLER_STATS) != 0;
+		tx.count = (smp.mode & SAMPLER_NODATA) ? 0 :
+			(SAMPLER_BLOCK + smp.decim - 1) / smp.decim;
+		tx.pos = 0;
+
+		if(tx.stats)
+		{
+			Sampler_Stats(tx.index, &tx.st);
+		}
+		if(tx.count > 0)
+		{
+			tx.data = Sampler_Decimate(smp.block[tx.index]);
+		}
+	}
+
+	if(tx.stats)
+	{
+		payload[0] = SAMPLER_TAG;
+		payload[1] = SAMPLER_REC_STATS;
+		payload[2] = tx.seq;
+		payload[3] = (uint8_t)(tx.st.min >> 8);
+		payload[4] = (uint8_t)tx.st.min;
+		payload[5] = (uint8_t)(tx.st.max >> 8);
+		payload[6] = (uint8_t)tx.st.max;
+		payload[7] = (uint8_t)(tx.st.mean >> 8);
+		payload[8] = (uint8_t)tx.st.mean;
+
+		if(!SerialComm_SendPacket(payload, SAMPLER_HDR + 6))
+		{
+			return false;
+		}
+		tx.stats = false;
+	}
+
+	while(tx.pos < tx.count)
+	{
+		size = Sampler_Encode(payload, &n);
+		if(!SerialComm_SendPacket(payload, size))
+		{
+			return false;
+		}
+		tx.pos += n;
+	}
+
+	tx.active = false;
+	Sampler_Release(tx.index);
+
+	return true;
+}
+
+/**
+ * \return number of samples dropped since Sampler_Init()
+ */
+uint32_t Sampler_Lost(void)
+{
+	return smp.lost;
+}
+
+/** Timer callback
+ */
+static void Sampler_Timer(void)
+{
+	if(smp.read)
+	{
+		Sampler_Push(smp.read());
+	}
+}
+
+/** Average each group of decim samples into tx.out. The last group may be
+ * shorter. Returns the samples to be sent, the block itself if there is
+ * no decimation.
+ */
+static int16_t *Sampler_Decimate(const int16_t *block)
+{
+	int32_t sum;
+	int i, j, k, n;
+
+	if(smp.decim <= 1)
+	{
+		return (int16_t *)block;
+	}
+
+	for(i = 0, j = 0; i < SAMPLER_BLOCK; i += n, j++)
+	{
+		n = (SAMPLER_BLOCK - i < smp.decim) ? SAMPLER_BLOCK - i : smp.decim;
+		sum = 0;
+		for(k = 0; k < n; k++)
+		{
+			sum += block[i + k];
+		}
+		tx.out[j] = (int16_t)(sum / n);
+	}
+
+	return tx.out;
+}
+
+/** Build the next data packet from tx.pos. Returns the size of the
+ * payload and the number of samples in it.
+ */
+static int Sampler_Encode(uint8_t *payload, int *n)
+{
+	int16_t *block = tx.data;
+	int size = SAMPLER_HDR;
+	int i = tx.pos;
+	int32_t diff;
+
+	payload[0] = SAMPLER_TAG;
+	payload[2] = tx.seq;
+
+	// samples as they are
+	if(!(smp.mode & SAMPLER_DELTA))
+	{
+		payload[1] = SAMPLER_REC_RAW;
+		for(; (i < tx.count) && (size + 2 <= MAX_PAYLOAD); i++)
+		{
+			payload[size++] = (uint8_t)(block[i] >> 8);
+			payload[size++] = (uint8_t)block[i];
+		}
+		*n = i - tx.pos;
+		return size;
+	}
+
+	// the first sample and the differences that fit in a byte
+	payload[1] = SAMPLER_REC_DELTA;
+	payload[size++] = (uint8_t)(block[i] >> 8);
+	payload[size++] = (uint8_t)block[i];
+	for(i++; (i < tx.count) && (size < MAX_PAYLOAD); i++)
+	{
+		diff = (int32_t)block[i] - block[i - 1];
+		if((diff < -128) || (diff > 127))
+		{
+			break;
+		}
+		payload[size++] = (uint8_t)diff;
+	}
+
+	*n = i - tx.pos;
+	return size;
+}
@@ -0,0 +1,321 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "SerialBatch.h"
+#include "UsrTimer.h"
+#include "EvtQueue.h"
+
+static struct
+{
+	uint8_t frame[MAX_PAYLOAD];
+	uint8_t size;			///< number of bytes in the frame
+	uint8_t count;			///< number of reports in the frame
+	int timer;				///< flush timer index, -1 if not running
+} batch = { {BATCH_TAG}, 1, 0, -1 };
+
+static int SerialBatch_Take(uint8_t *frame, int *count);
+static void SerialBatch_Restore(uint8_t *frame, int fsize, int count);
+static bool SerialBatch_Send(uint8_t *frame, int fsize, int count);
+static void SerialBatch_Timeout(void);
+
+/**
+ * The frame buffer is emptied and the flush timer is cleared if any.
+ * Note that the reports in the frame are discarded.
+ */
+void SerialBatch_Init(void)
+{
+	if(batch.timer >= 0)
+	{
+		UsrTimer_Clear(batch.timer);
+	}
+
+	// only the tag byte
+	batch.frame[0] = BATCH_TAG;
+	batch.size = 1;
+	batch.count = 0;
+	batch.timer = -1;
+}
+
+/**
+ * Append a report at the end of the frame. The frame is sent first if
+ * there is no room left for the report. When the report is the first one
+ * in the frame, the flush timer is started so that it does not wait longer
+ * than BATCH_TIMEOUT.
+ *
+ * While the peer is busy (see SerialComm_PeerBusy()), a full frame is kept
+ * and the report is refused, so that the caller can hold it and try again.
+ * This is also the case if the frame is refused by SerialComm_SendPacket().
+ *
+ * Access to the frame is protected by UsrTimer_Enable() since the flush
+ * timer callback runs in the timer interrupt.
+ *
+ * \param  report report data starting with the type byte
+ * \param  size size of the report
+ * \return false if the report cannot fit into a packet, or if the frame is
+ *         full while the peer is busy
+ */
+bool SerialBatch_Add(uint8_t *report, int size)
+{
+	uint8_t frame[MAX_PAYLOAD];
+	int fsize = 0;
+	int count;
+	int i;
+
+	// report is too large even for an empty frame
+	if((size <= 0) || (size + 2 > MAX_PAYLOAD))
+	{
+		return false;
+	}
+
+	// disable all timers
+	UsrTimer_Enable(false);
+	// no room for the report
+	if(batch.size + size + 1 > MAX_PAYLOAD)
+	{
+		// keep the frame until the peer is ready
+		if(SerialComm_PeerBusy())
+		{
+			UsrTimer_Enable(true);
+			return false;
+		}
+		fsize = SerialBatch_Take(frame, &count);
+	}
+	// enable all timers
+	UsrTimer_Enable(true);
+
+	// send the previous frame outside of the critical section
+	if(fsize > 0)
+	{
+		// the frame is back in place
+		if(!SerialBatch_Send(frame, fsize, count))
+		{
+			return false;
+		}
+		fsize = 0;
+	}
+
+	// disable all timers
+	UsrTimer_Enable(false);
+	// length byte
+	batch.frame[batch.size++] = (uint8_t)size;
+	// report bytes
+	for(i = 0; i < size; i++)
+	{
+		batch.frame[batch.size++] = report[i];
+	}
+	batch.count++;
+
+	// no room for another report: send unless the peer is busy, in which
+	// case the flush timer retries
+	if((batch.size + 2 > MAX_PAYLOAD) && !SerialComm_PeerBusy())
+	{
+		fsize = SerialBatch_Take(frame, &count);
+	}
+	// start the flush timer on the first report
+	else if(batch.count == 1)
+	{
+		batch.timer = UsrTimer_Set(BATCH_TIMEOUT, 1, SerialBatch_Timeout);
+		// no timer available: do not hold the report
+		if(batch.timer < 0)
+		{
+			fsize = SerialBatch_Take(frame, &count);
+		}
+	}
+	// enable all timers
+	UsrTimer_Enable(true);
+
+	// the report is in the frame even if it is refused
+	if(fsize > 0)
+	{
+		SerialBatch_Send(frame, fsize, count);
+	}
+
+	return true;
+}
+
+/**
+ * Send the reports in the frame without waiting for the timeout. Nothing
+ * is sent if the frame is empty. This is also the handler of the
+ * EVT_BATCH_FLUSH event posted by the flush timer, thus it should be
+ * called from the main loop only, like SerialComm_SendPacket().
+ *
+ * \return false if the peer is busy and the frame is kept
+ */
+bool SerialBatch_Flush(void)
+{
+	uint8_t frame[MAX_PAYLOAD];
+	int fsize;
+	int count;
+
+	// disable all timers
+	UsrTimer_Enable(false);
+	// keep the frame until the peer is ready, and try again later
+	if(SerialComm_PeerBusy())
+	{
+		if((batch.count > 0) && (batch.timer < 0))
+		{
+			batch.timer = UsrTimer_Set(BATCH_TIMEOUT, 1, SerialBatch_Timeout);
+		}
+		UsrTimer_Enable(true);
+		return false;
+	}
+	// take the frame out
+	fsize = SerialBatch_Take(frame, &count);
+	// enable all timers
+	UsrTimer_Enable(true);
+
+	if(fsize > 0)
+	{
+		return SerialBatch_Send(frame, fsize, count);
+	}
+
+	return true;
+}
+
+/**
+ * Call the report handler for each report in the packet retrieved by
+ * SerialComm_Decoder(). A packet without BATCH_TAG is regarded as a single
+ * report. The report is passed in place, thus it is valid only during the
+ * handler call.
+ *
+ * \param  packet packet retured by SerialComm_Decoder()
+ * \param  f report handler
+ * \return number of reports, -1 if a malformed record is found
+ */
+int SerialBatch_Unpack(uint8_t *packet, serialbatch_callback f)
+{
+	uint8_t *payload = &packet[2];
+	int size = packet[1];
+	int count = 0;
+	int i;
+
+	// empty packet
+	if(size == 0)
+	{
+		return 0;
+	}
+
+	// ordinary packet
+	if(payload[0] != BATCH_TAG)
+	{
+		f(payload, size);
+		return 1;
+	}
+
+	// walk through the records
+	for(i = 1; i < size; i += payload[i] + 1)
+	{
+		// invalid record length: drop the rest
+		if((payload[i] == 0) || (i + 1 + payload[i] > size))
+		{
+			return -1;
+		}
+
+		f(&payload[i + 1], payload[i]);
+		count++;
+	}
+
+	return count;
+}
+
+/** Move the frame contents to the given array and empty the frame. Returns
+ * the size, 0 if there is no report. Should be called with timers disabled.
+ */
+static int SerialBatch_Take(uint8_t *frame, int *count)
+{
+	int size = 0;
+	int i;
+
+	// stop the flush timer
+	if(batch.timer >= 0)
+	{
+		UsrTimer_Clear(batch.timer);
+		batch.timer = -1;
+	}
+
+	*count = batch.count;
+	if(batch.count > 0)
+	{
+		for(i = 0; i < batch.size; i++)
+		{
+			frame[size++] = batch.frame[i];
+		}
+	}
+
+	// empty the frame
+	batch.size = 1;
+	batch.count = 0;
+
+	return size;
+}
+
+/** Put a frame taken by SerialBatch_Take() back into the empty frame buffer
+ * and start the flush timer to try again. Should be called with timers
+ * disabled.
+ */
+static void SerialBatch_Restore(uint8_t *frame, int fsize, int count)
+{
+	int i;
+
+	for(i = 0; i < fsize; i++)
+	{
+		batch.frame[i] = frame[i];
+	}
+	batch.size = fsize;
+	batch.count = count;
+
+	if(batch.timer < 0)
+	{
+		batch.timer = UsrTimer_Set(BATCH_TIMEOUT, 1, SerialBatch_Timeout);
+	}
+}
+
+/** Send a frame taken by SerialBatch_Take(). A frame with a single report
+ * is sent as an ordinary payload. If the packet is refused, the frame is
+ * put back. Called outside of the critical section.
+ */
+static bool SerialBatch_Send(uint8_t *frame, int fsize, int count)
+{
+	bool sent;
+
+	// single report: skip the tag and the length byte
+	if(count == 1)
+	{
+		sent = SerialComm_SendPacket(&frame[2], fsize - 2);
+	}
+	else
+	{
+		sent = SerialComm_SendPacket(frame, fsize);
+	}
+
+	if(!sent)
+	{
+		UsrTimer_Enable(false);
+		SerialBatch_Restore(frame, fsize, count);
+		UsrTimer_Enable(true);
+	}
+
+	return sent;
+}
+
+/** Flush timer callback. The timer is a one-shot timer, which is cleared
+ * by UsrTimer_Routine() after this call. The frame is not sent here, since
+ * the main loop may be in the middle of another packet, but the main loop
+ * is asked to call SerialBatch_Flush(). If the queue is full, another
+ * timer is started to ask again.
+ */
+static void SerialBatch_Timeout(void)
+{
+	uint8_t event[EVT_QWIDTH] = { EVT_BATCH_FLUSH };
+
+	// do not let SerialBatch_Take() clear the timer
+	batch.timer = -1;
+
+	if(!Evt_EnQueue(event))
+	{
+		batch.timer = UsrTimer_Set(BATCH_TIMEOUT, 1, SerialBatch_Timeout);
+	}
+}
@@ -4,14 +4,25 @@
  * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
  */
 #include "SerialComm.h"
+#include "Trace.h"
+#include "InputRec.h"
+#include "IrqLock.h"
+#include "Prof.h"
 #include <stdbool.h>
 
-// packet decoding state machine states
-#define PKT_STATE_HDR			0
-#define PKT_STATE_LEN			1
-#define PKT_STATE_PLD			2
-#define PKT_STATE_CSM			3
+extern uint32_t HAL_GetTick(void);
 
+// flow control state
+static struct
+{
+	volatile bool busy;			///< this end is busy
+	volatile bool sending;		///< SerialComm_SendPacket() in progress
+	volatile bool pending;		///< XOFF / XON held until the packet ends
+	volatile bool peer_busy;	///< XOFF received from the peer
+	volatile uint32_t peer_time;	///< HAL_GetTick() at the last XOFF
+} flow;
+
+static pkt_status SerialComm_Step(pkt_decoder *dec, uint8_t byte);
 
 /**
  * This function runs packet decoding state machine. It takes stream of serial
@@ -37,6 +48,9 @@ if(UART_RX_flag_is_set)
     }
 }
 \endcode
+ *
+ * This function keeps its own decoder state and copies the packet into the
+ * buffer. Use SerialComm_Decode() to assemble the packet in place.
  *
  * \param	byte received byte
  * \param   buffer packet will be retured here
@@ -44,41 +58,119 @@ if(UART_RX_flag_is_set)
  */
 pkt_status SerialComm_Decoder(uint8_t byte, uint8_t *buffer)
 {
-	static uint8_t state = PKT_STATE_HDR;
-	static uint8_t index = 0;
 	static uint8_t packet[MAX_PKTSIZE] = {0};
-	static uint8_t csum = 0;
+	static pkt_decoder dec = { PKT_STATE_HDR, 0, 0, packet };
 
+	pkt_status status;
 	int i;
 
+	status = SerialComm_Decode(&dec, byte);
+
+	if(status == PKT_RECEIVED)
+	{
+		// copy packet to the buffer
+		for(i = 0; i < packet[1] + 3; i++)
+		{
+			buffer[i] = packet[i];
+		}
+	}
+
+	return status;
+}
+
+/**
+ * Set the decoder state to wait for a header and the packet storage.
+ *
+ * \param dec decoder state
+ * \param packet storage of MAX_PKTSIZE bytes
+ */
+void SerialComm_InitDecoder(pkt_decoder *dec, uint8_t *packet)
+{
+	dec->state = PKT_STATE_HDR;
+	dec->index = 0;
+	dec->csum = 0;
+	dec->packet = packet;
+}
+
+/**
+ * Packet decoding state machine on the given state. The packet is assembled
+ * directly in dec->packet, which holds the whole packet when PKT_RECEIVED
+ * is returned. To keep the packet, point dec->packet to new storage before
+ * the next byte. The storage can be replaced at any time the state is
+ * PKT_STATE_HDR.
+ *
+ * ACK, NAK, IAM, XOFF and XON are recognized only between packets, since
+ * the same values can appear in the payload. SerialComm_SetBusy() keeps
+ * XOFF and XON off the packets sent by this end.
+ *
+ * \param	dec decoder state
+ * \param	byte received byte
+ * \return  pkt_status status of the state machine
+ */
+pkt_status SerialComm_Decode(pkt_decoder *dec, uint8_t byte)
+{
+	pkt_status status;
+	PROF_ENTER(PROF_ACT_DECODE);
+
+	status = SerialComm_Step(dec, byte);
+	PROF_LEAVE();
+
+	return status;
+}
+
+/** One byte of the state machine of SerialComm_Decode()
+ */
+static pkt_status SerialComm_Step(pkt_decoder *dec, uint8_t byte)
+{
+	uint8_t *packet = dec->packet;
+
+	INPUTREC_SERIAL(byte);
+
 	// waiting for the header byte
-	if(state == PKT_STATE_HDR)
+	if(dec->state == PKT_STATE_HDR)
 	{
 		if(byte == PKT_HEADR)
 		{
 			// store the header byte
 			packet[0] = byte;
 			// proceed to the next state
-			state = PKT_STATE_LEN;
+			dec->state = PKT_STATE_LEN;
 		}
 		else if(byte == PKT_ACK)
 		{
 			// ACK received but do not change the state
+			TRACE(TRC_PKT, ACK_RECEIVED, 0);
 			return ACK_RECEIVED;
 		}
 		else if(byte == PKT_NAK)
 		{
 			// NAK received but do not change the state
+			TRACE(TRC_PKT, NAK_RECEIVED, 0);
 			return NAK_RECEIVED;
 		}
 		else if(byte == PKT_IAM)
 		{
 			// IAM received but do not change the state
+			TRACE(TRC_PKT, IAM_RECEIVED, 0);
 			return IAM_RECEIVED;
 		}
+		else if(byte == PKT_XOFF)
+		{
+			// hold the packets until XON or timeout
+			flow.peer_time = HAL_GetTick();
+			flow.peer_busy = true;
+			TRACE(TRC_PKT, XOFF_RECEIVED, 0);
+			return XOFF_RECEIVED;
+		}
+		else if(byte == PKT_XON)
+		{
+			flow.peer_busy = false;
+			TRACE(TRC_PKT, XON_RECEIVED, 0);
+			return XON_RECEIVED;
+		}
 	}
 	// waiting for the length byte
-	else if(state == PKT_STATE_LEN)
+	else if(dec->state == PKT_STATE_LEN)
 	{
 		// store the length byte
 		packet[1] = byte;
@@ -87,58 +179,55 @@ pkt_status SerialComm_Decoder(uint8_t byte, uint8_t *buffer)
 		if(byte > MAX_PAYLOAD)
 		{
 			// start all over
-			state = PKT_STATE_HDR;
+			dec->state = PKT_STATE_HDR;
 			// report size error
+			TRACE(TRC_PKT, PKT_SIZE_ERR, byte);
 			return PKT_SIZE_ERR;
 		}
 		// length byte is valid
 		else
 		{
 			// reset index
-			index = 2;
+			dec->index = 2;
 			// clear chesum byte
-			csum = 0;
+			dec->csum = 0;
 			// proceed to the next state
-			state = PKT_STATE_PLD;
+			dec->state = (byte == 0) ? PKT_STATE_CSM : PKT_STATE_PLD;
 		}
 	}
 	// waiting for the payload
-	else if(state == PKT_STATE_PLD)
+	else if(dec->state == PKT_STATE_PLD)
 	{
 		// collect data
-		packet[index++] = byte;
+		packet[dec->index++] = byte;
 		// process checksum
-		csum ^= byte;
+		dec->csum ^= byte;
 		// proceed to the next if all payload is collected
-		if(index == (packet[1] + 2))
+		if(dec->index == (packet[1] + 2))
 		{
-			state = PKT_STATE_CSM;
+			dec->state = PKT_STATE_CSM;
 		}
 	}
 	// waiting for the checksum byte
-	else if(state == PKT_STATE_CSM)
+	else if(dec->state == PKT_STATE_CSM)
 	{
 		// collect data
-		packet[index] = byte;
+		packet[dec->index] = byte;
+		// start all over again
+		dec->state = PKT_STATE_HDR;
+
 		// checksum matches
-		if(byte == csum)
+		if(byte == dec->csum)
 		{
-			// copy packet to the buffer
-			for(i = 0; i < packet[1] + 3; i++)
-			{
-				buffer[i] = packet[i];
-			}
-			// start all over again
-			state = PKT_STATE_HDR;
 			// valid packet arrived
+			TRACE(TRC_PKT, PKT_RECEIVED, packet[1]);
 			return PKT_RECEIVED;
 		}
 		// checksum does not match
 		else
 		{
-			// start all over
-			state = PKT_STATE_HDR;
 			// checksum error
+			TRACE(TRC_PKT, PKT_CSUM_ERR, packet[1]);
 			return PKT_CSUM_ERR;
 		}
 	}
@@ -162,18 +251,28 @@ payload[4] = (value) & 0xff;
 # send the packet
 SerialComm_SendPacket(payload, 5, packet);
 \endcode
+ *
+ * The packet is not sent while the peer is busy, i.e. after XOFF is
+ * received and before XON or SERIALCOMM_XOFF_TIMEOUT. The caller should
+ * keep the payload and try again later.
  *
  * \param   payload payload data
  * \param   size size of the payload
- * \param   packet resulting packet
- * \return  int the size of the packet
+ * \return  false if the peer is busy and the packet is not sent
  */
-void SerialComm_SendPacket(uint8_t *payload, int size)
+bool SerialComm_SendPacket(uint8_t *payload, int size)
 {
 	uint8_t csum = 0;
 	uint8_t packet[MAX_PKTSIZE];
+	uint32_t state;
 	int i;
 
+	// peer asked to hold
+	if(SerialComm_PeerBusy())
+	{
+		return false;
+	}
+
 	// header
 	packet[0] = PKT_HEADR;
 	// payload size
@@ -187,6 +286,108 @@ void SerialComm_SendPacket(uint8_t *payload, int size)
 	// checksum
 	packet[2 + size] = csum;
 
-	// send the array of bytes
+	// send the array of bytes, holding XOFF / XON off the frame
+	flow.sending = true;
 	SerialComm_SendByteArray(packet, size+3);
+
+	state = IrqLock_Enter();
+	flow.sending = false;
+	if(flow.pending)
+	{
+		flow.pending = false;
+		SerialComm_SendByte(flow.busy ? PKT_XOFF : PKT_XON);
+	}
+	IrqLock_Exit(state);
+
+	return true;
+}
+
+/**
+ * Set the busy state of this end. XOFF is sent when it becomes busy and XON
+ * when it becomes ready, so that the peer holds the packets in between.
+ * The function can be given to Evt_SetWatermark() to tie the state to the
+ * event queue occupancy.
+ *
+ * The function may be called from an interrupt, e.g. by Evt_EnQueue(),
+ * while the main loop is in SerialComm_SendPacket(). The decoder of the
+ * peer recognizes XOFF and XON only between packets, since the payload can
+ * hold the same values. The byte is thus held until the packet is sent,
+ * and then the current state is sent.
+ *
+ * \param busy true to hold the peer
+ */
+void SerialComm_SetBusy(bool busy)
+{
+	uint32_t state;
+
+	state = IrqLock_Enter();
+	if(busy != flow.busy)
+	{
+		flow.busy = busy;
+		if(flow.sending)
+		{
+			flow.pending = true;
+		}
+		else
+		{
+			SerialComm_SendByte(busy ? PKT_XOFF : PKT_XON);
+		}
+	}
+	IrqLock_Exit(state);
+}
+
+/**
+ * \return true if this end is busy
+ */
+bool SerialComm_Busy(void)
+{
+	return flow.busy;
+}
+
+/**
+ * The peer is regarded as ready again if XON does not come within
+ * SERIALCOMM_XOFF_TIMEOUT, in case XON is lost. The next packet then serves
+ * as a probe, which a busy peer answers by NAK and XOFF again.
+ *
+ * \return true if the peer asked to hold the packets
+ */
+bool SerialComm_PeerBusy(void)
+{
+	if(flow.peer_busy &&
+			((HAL_GetTick() - flow.peer_time) >= SERIALCOMM_XOFF_TIMEOUT))
+	{
+		flow.peer_busy = false;
+	}
+
+	return flow.peer_busy;
+}
+
+/**
+ * Answer a received packet with ACK if accepted, otherwise with NAK. While
+ * this end is busy, NAK is followed by XOFF to remind the peer.
+ *
+\code
+if(PKT_RECEIVED == SerialComm_Decoder(new_byte, buffer))
+{
+	// do not take more while busy
+	SerialComm_Reply(!SerialComm_Busy() && Evt_EnQueue(event));
+}
+\endcode
+ *
+ * \param accept true if the packet is accepted
+ */
+void SerialComm_Reply(bool accept)
+{
+	if(accept)
+	{
+		SerialComm_SendByte(PKT_ACK);
+	}
+	else
+	{
+		SerialComm_SendByte(PKT_NAK);
+		if(flow.busy)
+		{
+			SerialComm_SendByte(PKT_XOFF);
+		}
+	}
 }
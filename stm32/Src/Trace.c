@@ -0,0 +1,79 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ */
+
+#include "Trace.h"
+#include "SerialComm.h"
+
+#if MAX_PAYLOAD < 9
+#error "MAX_PAYLOAD is too small for the trace record"
+#endif
+
+#if (TRACE_DEPTH & TRACE_MASK) != 0
+#error "TRACE_DEPTH should be a power of 2"
+#endif
+
+trace_ring trace;
+
+/**
+ * The buffer is cleared and the recording starts.
+ */
+void Trace_Init(void)
+{
+	trace.head = 0;
+	trace.dumping = false;
+	trace.enable = true;
+}
+
+/**
+ * Send the records from the oldest to the newest, one record per packet.
+ * Recording is suspended during the dump and the buffer is cleared
+ * afterwards. If a packet is refused since the peer is busy, the function
+ * returns with recording still suspended, and the next call resumes from
+ * that record.
+ *
+ * \return false if the peer is busy and the dump is not complete
+ */
+bool Trace_Dump(void)
+{
+	uint8_t payload[9];
+	trace_record *rec;
+
+	if(!trace.dumping)
+	{
+		// suspend recording
+		trace.enable = false;
+		trace.dumping = true;
+
+		// the oldest record
+		trace.dump = (trace.head > TRACE_DEPTH) ? (trace.head - TRACE_DEPTH)
+			: 0;
+	}
+
+	for(; trace.dump < trace.head; trace.dump++)
+	{
+		rec = &trace.buff[trace.dump & TRACE_MASK];
+
+		payload[0] = TRACE_TAG;
+		payload[1] = (rec->time >> 24) & 0xff;
+		payload[2] = (rec->time >> 16) & 0xff;
+		payload[3] = (rec->time >> 8) & 0xff;
+		payload[4] = (rec->time) & 0xff;
+		payload[5] = rec->type;
+		payload[6] = rec->arg0;
+		payload[7] = (rec->arg1 >> 8) & 0xff;
+		payload[8] = (rec->arg1) & 0xff;
+
+		if(!SerialComm_SendPacket(payload, 9))
+		{
+			return false;
+		}
+	}
+
+	// clear buffer and resume recording
+	Trace_Init();
+
+	return true;
+}
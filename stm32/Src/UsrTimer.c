@@ -5,6 +5,9 @@
  */
 
 #include "UsrTimer.h"
+#include "Trace.h"
+#include "InputRec.h"
+#include "Prof.h"
 
 /// Timer mode
 typedef enum
@@ -26,9 +29,13 @@ static struct
 	usrtimer_callback callback;
 } USRTimers[MAX_USRTIMER];
 
+/// Functions called every tick
+static usrtimer_callback USRTicks[MAX_USRTICK];
+
 volatile bool usrtimer_enable = true;
 
-/** Timer structure will be cleared.
+/** Timer structure will be cleared. The tick functions are kept since
+ * they belong to the modules that registered them.
  */
 void UsrTimer_Init()
 {
@@ -41,9 +48,10 @@ void UsrTimer_Init()
 	}
 }
 
-/** Call this function to pause or to resume all timers at once.
+/** Call this function to pause or to resume all timers at once. It can be
+ * overridden by the platform, e.g. to be thread-safe.
  */
-void UsrTimer_Enable(bool flag)
+__attribute__((weak)) void UsrTimer_Enable(bool flag)
 {
 	usrtimer_enable = flag;
 }
@@ -96,6 +104,42 @@ int UsrTimer_Set(uint32_t period, uint32_t duration, usrtimer_callback f)
 	return -1;
 }
 
+/** The function is called by UsrTimer_Routine() at every tick, before the
+ * timers. Unlike a timer of period one, it does not take the turn of the
+ * timers. It should be as short as possible.
+ *
+ * \param   f function to call
+ * \return	index of the tick function, -1 if no slot is available
+ */
+int UsrTimer_SetTick(usrtimer_callback f)
+{
+	int i;
+
+	for(i = 0; i < MAX_USRTICK; i++)
+	{
+		if(USRTicks[i] == NULL)
+		{
+			USRTicks[i] = f;
+			return i;
+		}
+	}
+
+	// no empty slot
+	return -1;
+}
+
+/** Remove the tick function registered by UsrTimer_SetTick().
+ *
+ * \param   index index of the tick function
+ */
+void UsrTimer_ClearTick(int index)
+{
+	if((index >= 0) && (index < MAX_USRTICK))
+	{
+		USRTicks[index] = NULL;
+	}
+}
+
 /** This will stop the timer from further execution and clear the relevant
  * information from the timer struct array.
  *
@@ -166,12 +210,25 @@ void UsrTimer_Resume(uint32_t index)
 void UsrTimer_Routine(void)
 {
 	int i;
+	PROF_ENTER(PROF_ACT_TIMER);
 
 	if(!usrtimer_enable)
 	{
+		PROF_LEAVE();
 		return;
 	}
 
+	INPUTREC_TICK();
+
+	// tick functions run every tick
+	for(i = 0; i < MAX_USRTICK; i++)
+	{
+		if(USRTicks[i])
+		{
+			USRTicks[i]();
+		}
+	}
+
 	// increase the counter value of each timer
 	for(i = 0; i < MAX_USRTIMER; i++)
 	{
@@ -193,7 +250,9 @@ void UsrTimer_Routine(void)
 			if(USRTimers[i].callback)
 			{
 				// run callback
+				TRACE(TRC_TMR_BEGIN, i, 0);
 				USRTimers[i].callback();
+				TRACE(TRC_TMR_END, i, 0);
 				// decrease the count value
 				USRTimers[i].count -= USRTimers[i].period;
 				// handle finite duration timer
@@ -211,4 +270,6 @@ void UsrTimer_Routine(void)
 			}
 		}
 	}
+
+	PROF_LEAVE();
 }
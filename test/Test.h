@@ -0,0 +1,46 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Checks of the host tests
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * Each test is a program that drives the utilities on a simulated clock,
+ * i.e. by calling UsrTimer_Routine() itself, and is linked with the host
+ * stubs (host/Inc/HostStub.h). A failed check prints the location and the
+ * expression, and the program returns nonzero at TEST_EXIT().
+ *
+\code
+int main(void)
+{
+	UsrTimer_Init();
+	Evt_InitQueue();
+	TEST_CHECK(Evt_Count() == 0);
+
+	return TEST_EXIT();
+}
+\endcode
+ */
+
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdio.h>
+
+/// Number of failed checks
+static int test_failed;
+
+/// Report the expression if it is false
+#define TEST_CHECK(cond)		do { if(!(cond)) { test_failed++; \
+									printf("%s:%d: %s\n", __FILE__, __LINE__, \
+										#cond); } } while(0)
+/// Report the values if they differ
+#define TEST_EQUAL(a, b)		do { long a_ = (long)(a), b_ = (long)(b); \
+									if(a_ != b_) { test_failed++; \
+									printf("%s:%d: %s == %s: %ld != %ld\n", \
+										__FILE__, __LINE__, #a, #b, a_, b_); } \
+								} while(0)
+/// Exit code of the program
+#define TEST_EXIT()				(printf("%s\n", test_failed ? "FAIL" : "PASS"), \
+									test_failed ? 1 : 0)
+
+#endif // __TEST_H
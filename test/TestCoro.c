@@ -0,0 +1,114 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Packet sessions of Coro
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * Each packet event is handed to the one task waiting for its session,
+ * which releases the block. The pool should be full again at the end.
+ */
+
+#include "Test.h"
+#include "UsrTimer.h"
+#include "Coro.h"
+#include "ActSvc.h"
+
+typedef struct
+{
+	coro_task task;
+	uint8_t sid;
+	int packets;
+	int timeouts;
+} session;
+
+static session s[3];
+
+static void Test_Session(coro_task *t)
+{
+	session *ss = (session *)t;
+
+	CORO_BEGIN(t);
+
+	while(1)
+	{
+		CORO_AWAIT_PACKET(t, ss->sid, 20);
+		if(CORO_TIMEDOUT(t))
+		{
+			ss->timeouts++;
+			continue;
+		}
+
+		TEST_EQUAL(EvtPool_Data(t->event[1])[2], ss->sid);
+		ss->packets++;
+		EvtPool_Release(t->event[1]);
+	}
+
+	CORO_END(t);
+}
+
+/** Post a packet of the session, as the SerialComm object does
+ */
+static bool Test_Packet(uint8_t sid)
+{
+	uint8_t event[EVT_QWIDTH] = { EVT_SCOM_PACKET };
+	uint8_t *packet;
+	bool flag;
+
+	event[1] = EvtPool_Alloc();
+	packet = EvtPool_Data(event[1]);
+	packet[0] = PKT_HEADR;
+	packet[1] = 1;
+	packet[2] = sid;
+	packet[3] = sid;
+
+	flag = Coro_Dispatch(event);
+	// packet of no session
+	if(!flag)
+	{
+		EvtPool_Release(event[1]);
+	}
+
+	return flag;
+}
+
+int main(void)
+{
+	int i;
+
+	UsrTimer_Init();
+	EvtPool_Init();
+	Coro_Init();
+
+	for(i = 0; i < 3; i++)
+	{
+		s[i].sid = 0x10 + i;
+		TEST_CHECK(Coro_Start(&s[i].task, Test_Session));
+	}
+	// all tasks reach the wait
+	Coro_Run();
+
+	for(i = 0; i < 30; i++)
+	{
+		TEST_CHECK(Test_Packet(0x10 + i % 3));
+	}
+	TEST_CHECK(!Test_Packet(0x20));
+
+	for(i = 0; i < 3; i++)
+	{
+		TEST_EQUAL(s[i].packets, 10);
+	}
+	TEST_EQUAL(EvtPool_Free(), EVTPOOL_BLOCKS);
+
+	// timeouts
+	for(i = 0; i < 50; i++)
+	{
+		UsrTimer_Routine();
+		Coro_Run();
+	}
+	for(i = 0; i < 3; i++)
+	{
+		TEST_EQUAL(s[i].timeouts, 2);
+	}
+
+	return TEST_EXIT();
+}
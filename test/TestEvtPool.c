@@ -0,0 +1,53 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Reference counts of EvtPool
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * A block returns to the pool with its last reference only. A second
+ * release must leave the pool as it is; it is checked only when assert()
+ * is compiled out, since EVTPOOL_FAULT() stops the program otherwise.
+ */
+
+#include "Test.h"
+#include "EvtPool.h"
+
+int main(void)
+{
+	uint8_t handle[EVTPOOL_BLOCKS];
+	int i;
+
+	EvtPool_Init();
+	TEST_EQUAL(EvtPool_Free(), EVTPOOL_BLOCKS);
+
+	for(i = 0; i < EVTPOOL_BLOCKS; i++)
+	{
+		handle[i] = EvtPool_Alloc();
+		TEST_CHECK(handle[i] != 0);
+	}
+	TEST_EQUAL(EvtPool_Alloc(), 0);
+
+	// two owners
+	EvtPool_Retain(handle[0]);
+	TEST_CHECK(!EvtPool_Release(handle[0]));
+	TEST_EQUAL(EvtPool_Free(), 0);
+	TEST_CHECK(EvtPool_Release(handle[0]));
+	TEST_EQUAL(EvtPool_Free(), 1);
+
+#ifdef NDEBUG
+	// double release: neither wraps the count nor frees the block again
+	TEST_CHECK(!EvtPool_Release(handle[0]));
+	TEST_EQUAL(EvtPool_Free(), 1);
+	TEST_EQUAL(EvtPool_Alloc(), handle[0]);
+	TEST_EQUAL(EvtPool_Alloc(), 0);
+	TEST_CHECK(EvtPool_Release(handle[0]));
+#endif
+
+	for(i = 1; i < EVTPOOL_BLOCKS; i++)
+	{
+		TEST_CHECK(EvtPool_Release(handle[i]));
+	}
+	TEST_EQUAL(EvtPool_Free(), EVTPOOL_BLOCKS);
+
+	return TEST_EXIT();
+}
@@ -0,0 +1,157 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Gestures of PushButton in edge-triggered mode
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * A timeline of button edges, with the contact bounce, is played on a 1 ms
+ * tick. Each edge calls PushButton_Edge() as the EXTI callback would. The
+ * gesture should be reported once, and the scan should stop when the
+ * button is idle again.
+ */
+
+#include "Test.h"
+#include "UsrTimer.h"
+#include "PushButton.h"
+
+/// Length of a run in ticks
+#define TEST_TICKS				3000
+
+/// Level change of button 0 at a tick
+typedef struct
+{
+	int time;
+	uint8_t level;
+} edge;
+
+static uint8_t button;
+static int now;
+static int last_scan;
+static int scans;
+static uint8_t codes[8];
+static uint8_t data[8];
+static int times[8];
+static int nevents;
+
+uint8_t PushButton_Read(void)
+{
+	last_scan = now;
+	scans++;
+
+	return button;
+}
+
+static bool Test_Sink(uint8_t *event)
+{
+	if(nevents < 8)
+	{
+		codes[nevents] = event[2];
+		data[nevents] = event[3];
+		times[nevents] = now;
+	}
+	nevents++;
+
+	return true;
+}
+
+/** Play the edges of n entries and run TEST_TICKS ticks
+ */
+static void Test_Play(const edge *e, int n)
+{
+	int i = 0;
+
+	UsrTimer_Init();
+	PushButton_InitEdge(0x01);
+	PushButton_SetSink(Test_Sink);
+	button = 0;
+	last_scan = -1;
+	scans = 0;
+	nevents = 0;
+
+	for(now = 0; now < TEST_TICKS; now++)
+	{
+		for(; (i < n) && (e[i].time == now); i++)
+		{
+			button = e[i].level;
+			PushButton_Edge();
+		}
+		UsrTimer_Routine();
+	}
+}
+
+int main(void)
+{
+	// click with 5 ms of bounce at both ends
+	static const edge bounce[] =
+	{
+		{ 100, 1 }, { 101, 0 }, { 102, 1 }, { 103, 0 }, { 104, 1 },
+		{ 300, 0 }, { 301, 1 }, { 302, 0 }, { 304, 1 }, { 305, 0 },
+	};
+	// glitch shorter than the debounce delay
+	static const edge glitch[] =
+	{
+		{ 100, 1 }, { 102, 0 },
+	};
+	// held for 2 s
+	static const edge hold[] =
+	{
+		{ 100, 1 }, { 101, 0 }, { 102, 1 },
+		{ 2100, 0 }, { 2101, 1 }, { 2102, 0 },
+	};
+	// two and three clicks 200 ms apart
+	static const edge dclick[] =
+	{
+		{ 100, 1 }, { 101, 0 }, { 102, 1 }, { 200, 0 }, { 201, 1 }, { 202, 0 },
+		{ 300, 1 }, { 301, 0 }, { 302, 1 }, { 400, 0 }, { 401, 1 }, { 402, 0 },
+	};
+	static const edge tclick[] =
+	{
+		{ 100, 1 }, { 200, 0 }, { 201, 1 }, { 202, 0 },
+		{ 300, 1 }, { 400, 0 }, { 401, 1 }, { 402, 0 },
+		{ 500, 1 }, { 600, 0 }, { 601, 1 }, { 602, 0 },
+	};
+
+	// a single click for the bouncing edges
+	Test_Play(bounce, sizeof(bounce) / sizeof(bounce[0]));
+	TEST_EQUAL(nevents, 1);
+	TEST_EQUAL(codes[0], PBTN_SCLK);
+	TEST_EQUAL(data[0], 1);
+	TEST_CHECK(times[0] > 305);
+	// the scan stops after the click
+	TEST_EQUAL(last_scan, times[0]);
+
+	// one scan after the debounce delay and nothing else
+	Test_Play(glitch, sizeof(glitch) / sizeof(glitch[0]));
+	TEST_EQUAL(nevents, 0);
+	TEST_EQUAL(scans, 1);
+	// within a tick of the delay: the tick of the edge counts
+	TEST_CHECK(last_scan >= 100 + PUSHBTN_DEBOUNCE - 1);
+	TEST_CHECK(last_scan <= 100 + PUSHBTN_DEBOUNCE);
+
+	// long click while held, no click at the release
+	Test_Play(hold, sizeof(hold) / sizeof(hold[0]));
+	TEST_EQUAL(nevents, 1);
+	TEST_EQUAL(codes[0], PBTN_LCLK);
+	TEST_CHECK(times[0] > 100 + PUSHBTN_TO_LONG * PUSHBTN_TMR_PERIOD);
+	TEST_CHECK(times[0] < 2100);
+	TEST_CHECK(last_scan < 2102 + 2 * PUSHBTN_TMR_PERIOD);
+
+	// double click after the multi-click window
+	Test_Play(dclick, sizeof(dclick) / sizeof(dclick[0]));
+	TEST_EQUAL(nevents, 1);
+	TEST_EQUAL(codes[0], PBTN_DCLK);
+	TEST_EQUAL(data[0], 2);
+	TEST_CHECK(times[0] > 402 + PUSHBTN_TO_SHORT * PUSHBTN_TMR_PERIOD);
+	TEST_EQUAL(last_scan, times[0]);
+
+	// triple click at the third release
+	Test_Play(tclick, sizeof(tclick) / sizeof(tclick[0]));
+	TEST_EQUAL(nevents, 1);
+	TEST_EQUAL(codes[0], PBTN_TCLK);
+	TEST_EQUAL(data[0], 3);
+	TEST_CHECK(times[0] >= 602);
+	TEST_CHECK(times[0] <= 602 + PUSHBTN_TMR_PERIOD);
+	TEST_EQUAL(last_scan, times[0]);
+
+	return TEST_EXIT();
+}
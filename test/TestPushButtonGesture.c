@@ -0,0 +1,164 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Chord and hold repeat of PushButton
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * A timeline of button levels is played on a 1 ms tick with the periodic
+ * scan. A chord should be reported once per press, without the clicks of
+ * its buttons, and the hold repeat interval should get shorter down to
+ * repeat_min.
+ */
+
+#include "Test.h"
+#include "UsrTimer.h"
+#include "PushButton.h"
+
+/// Length of a run in ticks
+#define TEST_TICKS				6000
+/// Number of events kept
+#define TEST_MAX_EVT			32
+
+/// Button levels from a tick on
+typedef struct
+{
+	int time;
+	uint8_t level;
+} level;
+
+static uint8_t button;
+static int now;
+static uint8_t ids[TEST_MAX_EVT];
+static uint8_t codes[TEST_MAX_EVT];
+static uint8_t data[TEST_MAX_EVT];
+static int times[TEST_MAX_EVT];
+static int nevents;
+
+uint8_t PushButton_Read(void)
+{
+	return button;
+}
+
+static bool Test_Sink(uint8_t *event)
+{
+	if(nevents < TEST_MAX_EVT)
+	{
+		ids[nevents] = event[1];
+		codes[nevents] = event[2];
+		data[nevents] = event[3];
+		times[nevents] = now;
+	}
+	nevents++;
+
+	return true;
+}
+
+/** Number of events of the code
+ */
+static int Test_Count(uint8_t code)
+{
+	int i, n = 0;
+
+	for(i = 0; (i < nevents) && (i < TEST_MAX_EVT); i++)
+	{
+		if(codes[i] == code)
+		{
+			n++;
+		}
+	}
+
+	return n;
+}
+
+/** Play n entries of levels for TEST_TICKS ticks. The buttons and the
+ * chord are set up by the caller after PushButton_Init().
+ */
+static void Test_Play(const level *e, int n)
+{
+	int i = 0;
+
+	PushButton_SetSink(Test_Sink);
+	button = 0;
+	nevents = 0;
+
+	for(now = 0; now < TEST_TICKS; now++)
+	{
+		for(; (i < n) && (e[i].time == now); i++)
+		{
+			button = e[i].level;
+		}
+		UsrTimer_Routine();
+	}
+}
+
+int main(void)
+{
+	// button 0 then button 1 a scan later, three times. the first is
+	// held long enough for a long click.
+	static const level chord[] =
+	{
+		{ 100, 0x01 }, { 200, 0x03 }, { 1500, 0x02 }, { 1600, 0x00 },
+		{ 2000, 0x02 }, { 2020, 0x03 }, { 2300, 0x00 },
+		{ 3000, 0x03 }, { 3300, 0x01 }, { 3400, 0x00 },
+	};
+	// button 0 held for 5 s
+	static const level hold[] =
+	{
+		{ 100, 0x01 }, { 5100, 0x00 },
+	};
+	static const pushbtn_profile rpt = { 1, PUSHBTN_TO_SHORT, 5, 8, 2 };
+	int i, n, first;
+
+	// one chord event per press, and no event of the buttons
+	UsrTimer_Init();
+	PushButton_Init(0x03);
+	PushButton_SetChord(0, 0x03);
+	Test_Play(chord, sizeof(chord) / sizeof(chord[0]));
+	TEST_EQUAL(nevents, 3);
+	TEST_EQUAL(Test_Count(PBTN_CHRD), 3);
+	for(i = 0; (i < nevents) && (i < TEST_MAX_EVT); i++)
+	{
+		TEST_EQUAL(ids[i], 1);
+		TEST_EQUAL(data[i], 0x03);
+	}
+	TEST_CHECK(times[0] >= 200 && times[0] < 200 + PUSHBTN_TMR_PERIOD);
+	TEST_CHECK(times[1] >= 2020 && times[1] < 2020 + PUSHBTN_TMR_PERIOD);
+	TEST_CHECK(times[2] >= 3000 && times[2] < 3000 + PUSHBTN_TMR_PERIOD);
+
+	// without the chord, the same buttons report their own clicks
+	UsrTimer_Init();
+	PushButton_Init(0x03);
+	Test_Play(chord, sizeof(chord) / sizeof(chord[0]));
+	TEST_EQUAL(Test_Count(PBTN_CHRD), 0);
+	TEST_CHECK(nevents > 0);
+
+	// hold repeat: 8, 6, 5, 4, 3 and then 2 scans apart
+	UsrTimer_Init();
+	PushButton_Init(0x01);
+	PushButton_SetProfile(0, &rpt);
+	Test_Play(hold, sizeof(hold) / sizeof(hold[0]));
+	TEST_EQUAL(Test_Count(PBTN_LCLK), 1);
+	TEST_EQUAL(Test_Count(PBTN_SCLK), 0);
+	n = Test_Count(PBTN_RPT);
+	TEST_CHECK(n > 8);
+	TEST_CHECK(nevents <= TEST_MAX_EVT);
+	TEST_EQUAL(codes[0], PBTN_LCLK);
+	first = 1;
+	for(i = first; (i < nevents) && (i < TEST_MAX_EVT); i++)
+	{
+		TEST_EQUAL(codes[i], PBTN_RPT);
+		// the interval reported is the one that has passed
+		TEST_EQUAL(times[i] - times[i - 1], data[i] * PUSHBTN_TMR_PERIOD);
+		if(i > first)
+		{
+			// shorter, or at the minimum
+			TEST_CHECK((data[i] < data[i - 1]) ||
+					(data[i] == rpt.repeat_min));
+		}
+	}
+	TEST_EQUAL(data[first], rpt.to_repeat);
+	TEST_EQUAL(data[first + 1], 6);
+	TEST_EQUAL(data[nevents - 1], rpt.repeat_min);
+
+	return TEST_EXIT();
+}
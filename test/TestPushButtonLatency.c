@@ -0,0 +1,124 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Latency of the PushButton gestures
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * Each gesture is played by calling PushButton_Routine() once per scan,
+ * i.e. per PUSHBTN_TMR_PERIOD, and the number of scans from the scan that
+ * sees the last edge of the gesture to the event is printed and checked
+ * against the latency table of PushButton.h.
+ */
+
+#include "Test.h"
+#include "UsrTimer.h"
+#include "PushButton.h"
+
+static uint8_t button;
+static int scan;
+static int event_scan;
+static uint8_t event_code;
+static uint8_t event_data;
+
+uint8_t PushButton_Read(void)
+{
+	return button;
+}
+
+static bool Test_Sink(uint8_t *event)
+{
+	// the first event only
+	if(event_scan < 0)
+	{
+		event_scan = scan;
+		event_code = event[2];
+		event_data = event[3];
+	}
+
+	return true;
+}
+
+/** Run n scans with the button level
+ */
+static void Test_Scan(uint8_t level, int n)
+{
+	button = level;
+	while(n-- > 0)
+	{
+		PushButton_Routine();
+		scan++;
+	}
+}
+
+/**
+ * Play clicks of 2 scans down and 2 scans up, the last one held for hold
+ * scans, and return the scans from the last edge to the event.
+ *
+ * \param  profile detection profile
+ * \param  clicks number of presses
+ * \param  hold scans of the last press
+ * \return latency in scans, -1 if no event
+ */
+static int Test_Latency(const pushbtn_profile *profile, int clicks, int hold)
+{
+	int edge;
+
+	UsrTimer_Init();
+	PushButton_Init(0x01);
+	PushButton_Stop();
+	PushButton_SetSink(Test_Sink);
+	PushButton_SetProfile(0, profile);
+
+	scan = 0;
+	event_scan = -1;
+	Test_Scan(0, 2);
+
+	while(--clicks > 0)
+	{
+		Test_Scan(1, 2);
+		Test_Scan(0, 2);
+	}
+
+	// the last press: the event comes either while it is held or after
+	// the release
+	edge = scan;
+	Test_Scan(1, hold);
+	if(event_scan < 0)
+	{
+		edge = scan;
+		Test_Scan(0, PUSHBTN_TO_MAX);
+	}
+
+	return (event_scan < 0) ? -1 : event_scan - edge;
+}
+
+/** Print and check a row of the table
+ */
+static void Test_Row(const char *gesture, uint8_t max_click, int clicks,
+		int hold, uint8_t code, int expect)
+{
+	pushbtn_profile profile =
+	{
+		max_click, PUSHBTN_TO_SHORT, PUSHBTN_TO_LONG, 0, 0
+	};
+	int latency;
+
+	latency = Test_Latency(&profile, clicks, hold);
+	printf("%-14s max_click %d: %2d scans\n", gesture, max_click, latency);
+
+	TEST_EQUAL(event_code, code);
+	TEST_EQUAL(latency, expect);
+}
+
+int main(void)
+{
+	Test_Row("single click", 1, 1, 2, PBTN_SCLK, 0);
+	Test_Row("single click", 3, 1, 2, PBTN_SCLK, PUSHBTN_TO_SHORT);
+	Test_Row("double click", 2, 2, 2, PBTN_DCLK, 0);
+	Test_Row("double click", 3, 2, 2, PBTN_DCLK, PUSHBTN_TO_SHORT);
+	Test_Row("triple click", 3, 3, 2, PBTN_TCLK, 0);
+	Test_Row("5 click", 5, 5, 2, PBTN_NCLK, 0);
+	Test_Row("long click", 3, 1, PUSHBTN_TO_MAX, PBTN_LCLK, PUSHBTN_TO_LONG);
+
+	return TEST_EXIT();
+}
@@ -0,0 +1,182 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Record and replay of a session
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * A session of random button changes and packets is recorded by InputRec,
+ * dumped over SerialComm and fed back through the replay driver. The
+ * events retrieved and the packets decoded, with the tick of each, should
+ * be the same in both runs.
+ *
+ * The replay driver provides PushButton_Read(), thus the recording session
+ * takes the button state from it as well, one tick at a time.
+ */
+
+#include "Test.h"
+#include "UsrTimer.h"
+#include "EvtQueue.h"
+#include "PushButton.h"
+#include "SerialComm.h"
+#include "InputRec.h"
+#include "Replay.h"
+#include "HostStub.h"
+
+#include <string.h>
+
+#define TEST_TICKS				20000
+#define TEST_MAX_OUT			512
+#define TEST_CAPTURE			(4 * INPUTREC_SIZE)
+
+/// Event retrieved or packet decoded
+typedef struct
+{
+	uint32_t tick;
+	uint8_t data[EVT_QWIDTH];
+} test_out;
+
+static struct
+{
+	test_out out[2][TEST_MAX_OUT];
+	int count[2];
+	int run;					///< 0: recording, 1: replay
+	uint32_t tick;				///< ticks of the recording
+	uint8_t capture[TEST_CAPTURE];
+	int size;
+	uint32_t seed;
+} ts;
+
+static uint32_t Test_Rand(void)
+{
+	ts.seed = ts.seed * 1103515245 + 12345;
+
+	return (ts.seed >> 16) & 0x7fff;
+}
+
+static void Test_Out(uint32_t tick, const uint8_t *data, int size)
+{
+	test_out *o;
+
+	TEST_CHECK(ts.count[ts.run] < TEST_MAX_OUT);
+	if(ts.count[ts.run] < TEST_MAX_OUT)
+	{
+		o = &ts.out[ts.run][ts.count[ts.run]++];
+		memset(o, 0, sizeof(*o));
+		o->tick = tick;
+		memcpy(o->data, data, size);
+	}
+}
+
+static void Test_Capture(uint8_t *buffer, int size)
+{
+	TEST_CHECK(ts.size + size <= TEST_CAPTURE);
+	if(ts.size + size <= TEST_CAPTURE)
+	{
+		memcpy(&ts.capture[ts.size], buffer, size);
+		ts.size += size;
+	}
+}
+
+/** Replay handlers
+ */
+static void Test_Event(uint8_t *event)
+{
+	Test_Out(Replay_Ticks(), event, EVT_QWIDTH);
+}
+
+static void Test_Packet(uint8_t *packet)
+{
+	Test_Out(Replay_Ticks(), packet, 4);
+}
+
+/** A tick of the recording with the button state
+ */
+static void Test_Tick(uint8_t button)
+{
+	const uint8_t log[] = { REC_TICKS, 1, REC_BUTTON, button };
+
+	Replay_Run(log, sizeof(log), NULL);
+	ts.tick++;
+}
+
+/** Recording session
+ */
+static void Test_Record(void)
+{
+	static const uint8_t frame[] = { PKT_HEADR, 3, 1, 2, 3, 0 };
+	uint8_t event[EVT_QWIDTH];
+	uint8_t packet[MAX_PKTSIZE];
+	uint8_t button = 0;
+	unsigned i;
+	int t;
+
+	for(t = 0; t < TEST_TICKS; t++)
+	{
+		if(Test_Rand() % 150 == 0)
+		{
+			button ^= 1 << (Test_Rand() % 2);
+		}
+		Test_Tick(button);
+
+		if(Test_Rand() % 500 == 0)
+		{
+			for(i = 0; i < sizeof(frame); i++)
+			{
+				if(PKT_RECEIVED == SerialComm_Decoder(frame[i], packet))
+				{
+					Test_Out(ts.tick, packet, 4);
+				}
+			}
+		}
+
+		if(Test_Rand() % 3 == 0)
+		{
+			while(Evt_DeQueue(event))
+			{
+				Test_Out(ts.tick, event, EVT_QWIDTH);
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	static uint8_t log[INPUTREC_SIZE];
+	replay_handler h = { Test_Event, Test_Packet };
+	int size, i;
+
+	ts.seed = 7;
+	UsrTimer_Init();
+	Evt_InitQueue();
+	PushButton_Init(0x03);
+	InputRec_Start();
+	Test_Record();
+	InputRec_Stop();
+	TEST_CHECK(!InputRec_Overflow());
+
+	HostStub_SetTxHook(Test_Capture);
+	TEST_CHECK(InputRec_Dump());
+	HostStub_SetTxHook(NULL);
+
+	size = Replay_Extract(ts.capture, ts.size, log, sizeof(log));
+	TEST_EQUAL(size, InputRec_Size());
+
+	// same initialization as the recording
+	ts.run = 1;
+	UsrTimer_Init();
+	Evt_InitQueue();
+	PushButton_Init(0x03);
+	TEST_CHECK(Replay_Run(log, size, &h));
+	TEST_EQUAL(Replay_Ticks(), TEST_TICKS);
+
+	TEST_CHECK(ts.count[0] > 0);
+	TEST_EQUAL(ts.count[1], ts.count[0]);
+	for(i = 0; (i < ts.count[0]) && (i < ts.count[1]); i++)
+	{
+		TEST_EQUAL(ts.out[1][i].tick, ts.out[0][i].tick);
+		TEST_CHECK(!memcmp(ts.out[1][i].data, ts.out[0][i].data,
+				EVT_QWIDTH));
+	}
+
+	return TEST_EXIT();
+}
@@ -0,0 +1,122 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Sampler_Send() across a busy peer
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * Block A is refused by a busy peer, block B is sent after XON, then A is
+ * sent again from the start. Both must arrive decimated once, with the
+ * statistics of the raw samples.
+ */
+
+#include "Test.h"
+#include "HostStub.h"
+#include "SerialComm.h"
+#include "Sampler.h"
+
+#define TEST_DECIM				4
+
+static uint8_t events[2][EVT_QWIDTH];
+static int nevents;
+
+static pkt_decoder dec;
+static uint8_t packet[MAX_PKTSIZE];
+static int16_t rx[SAMPLER_BLOCK];
+static int nrx;
+static sampler_stats rx_st;
+
+static bool Test_Sink(uint8_t *event)
+{
+	int i;
+
+	for(i = 0; i < EVT_QWIDTH; i++)
+	{
+		events[nevents][i] = event[i];
+	}
+	nevents++;
+
+	return true;
+}
+
+/** Decode the packets sent and collect the samples
+ */
+static void Test_Rx(uint8_t *buffer, int size)
+{
+	int i;
+
+	while(size--)
+	{
+		if(SerialComm_Decode(&dec, *buffer++) != PKT_RECEIVED)
+		{
+			continue;
+		}
+		if(packet[3] == SAMPLER_REC_STATS)
+		{
+			rx_st.min = (int16_t)((packet[5] << 8) | packet[6]);
+			rx_st.max = (int16_t)((packet[7] << 8) | packet[8]);
+			rx_st.mean = (int16_t)((packet[9] << 8) | packet[10]);
+			continue;
+		}
+		for(i = 5; i + 1 < packet[1] + 2; i += 2)
+		{
+			rx[nrx++] = (int16_t)((packet[i] << 8) | packet[i + 1]);
+		}
+	}
+}
+
+/** Check the samples received against the block of the base value
+ */
+static void Test_Check(int base)
+{
+	int i;
+
+	TEST_EQUAL(nrx, SAMPLER_BLOCK / TEST_DECIM);
+	for(i = 0; i < nrx; i++)
+	{
+		// average of base + 4i ... base + 4i + 3
+		TEST_EQUAL(rx[i], base + TEST_DECIM * i + 1);
+	}
+	TEST_EQUAL(rx_st.min, base);
+	TEST_EQUAL(rx_st.max, base + SAMPLER_BLOCK - 1);
+	TEST_EQUAL(rx_st.mean, base + (SAMPLER_BLOCK - 1) / 2);
+
+	nrx = 0;
+}
+
+int main(void)
+{
+	uint8_t buffer[MAX_PKTSIZE];
+	int i;
+
+	SerialComm_InitDecoder(&dec, packet);
+	HostStub_SetTxHook(Test_Rx);
+	Sampler_Init(TEST_DECIM, SAMPLER_RAW | SAMPLER_STATS);
+	Sampler_SetSink(Test_Sink);
+
+	// blocks A and B
+	for(i = 0; i < 2 * SAMPLER_BLOCK; i++)
+	{
+		TEST_CHECK(Sampler_Push(1000 + i));
+	}
+	TEST_EQUAL(nevents, 2);
+
+	// A refused
+	SerialComm_Decoder(PKT_XOFF, buffer);
+	TEST_CHECK(!Sampler_Send(events[0]));
+	TEST_EQUAL(nrx, 0);
+
+	// B sent after XON
+	SerialComm_Decoder(PKT_XON, buffer);
+	TEST_CHECK(Sampler_Send(events[1]));
+	Test_Check(1000 + SAMPLER_BLOCK);
+
+	// A again from the start
+	TEST_CHECK(Sampler_Send(events[0]));
+	Test_Check(1000);
+
+	// and once more, as a consumer retrying the event would
+	TEST_CHECK(Sampler_Send(events[0]));
+	Test_Check(1000);
+
+	return TEST_EXIT();
+}
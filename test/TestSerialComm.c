@@ -0,0 +1,219 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	Flow control bytes of SerialComm
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * The bytes sent are fed to the decoder of a simulated peer. The busy state
+ * changes in the middle of a packet, as when the watermark of the event
+ * queue is crossed by an interrupt, and XOFF must follow the packet rather
+ * than break it.
+ *
+ * Then the peer sends XOFF toward this end in the middle of a dump or a
+ * batch. The senders should stop, keep what is not sent, and go on after
+ * XON without loss or repetition.
+ */
+
+#include "Test.h"
+#include "HostStub.h"
+#include "SerialComm.h"
+#include "SerialBatch.h"
+#include "Trace.h"
+#include "InputRec.h"
+#include "UsrTimer.h"
+#include "EvtQueue.h"
+
+static pkt_decoder peer;
+static uint8_t packet[MAX_PKTSIZE];
+static int packets;
+static int xoff;
+static int xon;
+static int errors;
+/// byte count at which the busy state changes, -1 for none
+static int busy_at = -1;
+static bool busy_to;
+static int nbytes;
+/// packet count at which the peer sends XOFF, -1 for none
+static int xoff_at = -1;
+/// payload bytes received
+static uint8_t rx[256];
+static int nrx;
+
+/** A byte from the peer to this end
+ */
+static void Test_ToDevice(uint8_t byte)
+{
+	uint8_t buffer[MAX_PKTSIZE];
+
+	SerialComm_Decoder(byte, buffer);
+}
+
+static void Test_Peer(uint8_t *buffer, int size)
+{
+	while(size--)
+	{
+		switch(SerialComm_Decode(&peer, *buffer++))
+		{
+			case PKT_RECEIVED:
+				for(int i = 0; i < packet[1]; i++)
+				{
+					if(nrx < (int)sizeof(rx))
+					{
+						rx[nrx++] = packet[2 + i];
+					}
+				}
+				if(++packets == xoff_at)
+				{
+					Test_ToDevice(PKT_XOFF);
+				}
+				break;
+			case XOFF_RECEIVED:
+				xoff++;
+				break;
+			case XON_RECEIVED:
+				xon++;
+				break;
+			case PKT_INPROCES:
+				break;
+			default:
+				errors++;
+				break;
+		}
+
+		// interrupt in the middle of the frame
+		if(nbytes++ == busy_at)
+		{
+			busy_at = -1;
+			SerialComm_SetBusy(busy_to);
+		}
+	}
+}
+
+/** Run n ticks, flushing the batch in the main loop when asked
+ */
+static void Test_Flush(int n)
+{
+	uint8_t event[EVT_QWIDTH];
+
+	while(n--)
+	{
+		UsrTimer_Routine();
+		while(Evt_DeQueue(event))
+		{
+			if(event[0] == EVT_BATCH_FLUSH)
+			{
+				SerialBatch_Flush();
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	uint8_t payload[MAX_PAYLOAD];
+	int i;
+
+	for(i = 0; i < MAX_PAYLOAD; i++)
+	{
+		// values of the control bytes in the payload
+		payload[i] = (i & 1) ? PKT_XOFF : PKT_XON;
+	}
+
+	SerialComm_InitDecoder(&peer, packet);
+	HostStub_SetTxHook(Test_Peer);
+
+	// between packets: sent at once
+	SerialComm_SetBusy(true);
+	TEST_EQUAL(xoff, 1);
+	SerialComm_SetBusy(false);
+	TEST_EQUAL(xon, 1);
+
+	// XOFF in the middle of a packet
+	nbytes = 0;
+	busy_at = 3;
+	busy_to = true;
+	TEST_CHECK(SerialComm_SendPacket(payload, MAX_PAYLOAD));
+	TEST_EQUAL(packets, 1);
+	TEST_EQUAL(xoff, 2);
+	TEST_EQUAL(errors, 0);
+	TEST_CHECK(SerialComm_Busy());
+
+	// XON in the middle of the next one. The peer shares the flow state of
+	// this end, so its XOFF holds this end too until the timeout.
+	HostStub_SetTick(SERIALCOMM_XOFF_TIMEOUT);
+	nbytes = 0;
+	busy_at = 5;
+	busy_to = false;
+	TEST_CHECK(SerialComm_SendPacket(payload, MAX_PAYLOAD));
+	TEST_EQUAL(packets, 2);
+	TEST_EQUAL(xon, 2);
+	TEST_EQUAL(errors, 0);
+	TEST_CHECK(!SerialComm_Busy());
+
+	// trace dump stopped by XOFF after 5 records
+	Trace_Init();
+	for(i = 0; i < 20; i++)
+	{
+		Trace_Record(TRC_USER, i, 0);
+	}
+	packets = nrx = 0;
+	xoff_at = 5;
+	TEST_CHECK(!Trace_Dump());
+	TEST_EQUAL(packets, 5);
+	TEST_CHECK(!Trace_Dump());
+	TEST_EQUAL(packets, 5);
+	Test_ToDevice(PKT_XON);
+	TEST_CHECK(Trace_Dump());
+	TEST_EQUAL(packets, 20);
+	for(i = 0; i < 20; i++)
+	{
+		// (TRACE_TAG)(TIME:4)(TYPE)(ARG0)(ARG1:2)
+		TEST_EQUAL(rx[i * 9 + 6], i);
+	}
+
+	// input record dump stopped after 3 packets
+	InputRec_Start();
+	for(i = 0; i < 30; i++)
+	{
+		InputRec_Button(i);
+	}
+	InputRec_Stop();
+	packets = nrx = 0;
+	xoff_at = 3;
+	TEST_CHECK(!InputRec_Dump());
+	TEST_EQUAL(packets, 3);
+	Test_ToDevice(PKT_XON);
+	TEST_CHECK(InputRec_Dump());
+	// without the tag bytes
+	TEST_EQUAL(nrx - packets, InputRec_Size());
+
+	// batch kept while the peer is busy
+	xoff_at = -1;
+	UsrTimer_Init();
+	Evt_InitQueue();
+	SerialBatch_Init();
+	packets = nrx = 0;
+	payload[0] = 0x01;
+	TEST_CHECK(SerialBatch_Add(payload, 3));
+	Test_ToDevice(PKT_XOFF);
+	TEST_CHECK(SerialBatch_Add(payload, 3));
+	TEST_CHECK(!SerialBatch_Add(payload, 3));
+	TEST_CHECK(!SerialBatch_Flush());
+	Test_Flush(2 * BATCH_TIMEOUT);
+	TEST_EQUAL(packets, 0);
+	Test_ToDevice(PKT_XON);
+	// not sent by the timer itself
+	for(i = 0; i < BATCH_TIMEOUT; i++)
+	{
+		UsrTimer_Routine();
+	}
+	TEST_EQUAL(packets, 0);
+	Test_Flush(1);
+	// both reports in one frame
+	TEST_EQUAL(packets, 1);
+	TEST_EQUAL(rx[0], BATCH_TAG);
+	TEST_EQUAL(nrx, 1 + 2 * 4);
+	TEST_CHECK(SerialBatch_Add(payload, 3));
+
+	return TEST_EXIT();
+}
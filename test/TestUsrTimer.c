@@ -0,0 +1,81 @@
+/**
+ * \file
+ * \author	<a href="http://www.innomatic.ca">innomatic</a>
+ * \brief	UsrTimer with the tick functions of the schedulers
+ * \copyright <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/"><img alt="Creative Commons Licence" style="border-width:0" src="https://i.creativecommons.org/l/by-nc/4.0/88x31.png" /></a><br />This work is licensed under a <a rel="license" href="http://creativecommons.org/licenses/by-nc/4.0/">Creative Commons Attribution-NonCommercial 4.0 International License</a>.
+ *
+ * The time events of ActObj and the tick count of Coro run from tick
+ * functions, so that they do not take the turn of the timers set after
+ * ActObj_Init() and Coro_Init().
+ */
+
+#include "Test.h"
+#include "UsrTimer.h"
+#include "ActObj.h"
+#include "Coro.h"
+
+#define TEST_TICKS				1000
+
+static int fired;
+static int posted;
+static actobj app;
+static uint8_t app_buff[8][EVT_QWIDTH];
+
+static void Test_Timer(void)
+{
+	fired++;
+}
+
+static void Test_Handler(uint8_t *event)
+{
+	(void)event;
+	posted++;
+}
+
+/** Run n ticks, serving the active objects in between
+ */
+static void Test_Run(int n)
+{
+	while(n--)
+	{
+		UsrTimer_Routine();
+		while(ActObj_Run());
+	}
+}
+
+int main(void)
+{
+	UsrTimer_Init();
+	ActObj_Init();
+	Coro_Init();
+	TEST_CHECK(ActObj_Start(&app, 1, app_buff, 8, Test_Handler));
+	TEST_CHECK(ActObj_TimeEvt(&app, 0x10, 5, 0) >= 0);
+
+	// timer set after the scheduler
+	TEST_CHECK(UsrTimer_Set(10, 0, Test_Timer) >= 0);
+	Test_Run(TEST_TICKS);
+	TEST_EQUAL(fired, TEST_TICKS / 10);
+	TEST_EQUAL(posted, TEST_TICKS / 5);
+	TEST_EQUAL(Coro_Ticks(), TEST_TICKS);
+
+	// the tick function survives the timer reset
+	fired = posted = 0;
+	UsrTimer_Init();
+	TEST_CHECK(UsrTimer_Set(10, 0, Test_Timer) >= 0);
+	Test_Run(TEST_TICKS);
+	TEST_EQUAL(fired, TEST_TICKS / 10);
+	TEST_EQUAL(posted, TEST_TICKS / 5);
+	TEST_EQUAL(Coro_Ticks(), 2 * TEST_TICKS);
+
+	// initialized again: registered only once
+	posted = 0;
+	ActObj_Init();
+	Coro_Init();
+	TEST_CHECK(ActObj_Start(&app, 1, app_buff, 8, Test_Handler));
+	TEST_CHECK(ActObj_TimeEvt(&app, 0x10, 5, 0) >= 0);
+	Test_Run(TEST_TICKS);
+	TEST_EQUAL(posted, TEST_TICKS / 5);
+	TEST_EQUAL(Coro_Ticks(), 3 * TEST_TICKS);
+
+	return TEST_EXIT();
+}
@@ -0,0 +1,141 @@
+"""
+Symbolize the histogram dumped by Prof_Dump() against the ELF file and
+print the hot spots by function, or by source line with --lines.
+
+The input is the raw byte stream captured from the serial port. Packets
+other than the profiler records are skipped. When the capture holds more
+than one dump, the last one is used.
+
+    python3 profsym.py capture.bin firmware.elf --prefix arm-none-eabi-
+    python3 profsym.py capture.bin ./app --lines --json
+"""
+
+import argparse
+import bisect
+import json
+import struct
+import subprocess
+import sys
+
+from serialpkt import packets
+
+PROF_TAG = 0xfc
+
+PROF_REC_SUMMARY = 0
+PROF_REC_ACT = 1
+PROF_REC_PC = 2
+
+# activities marked by the utilities, PROF_ACT_* of Prof.h
+ACT_NAMES = {0: 'idle', 1: 'timer', 2: 'event', 3: 'decode'}
+
+
+def histogram(data, max_payload):
+    """Return (samples, lost, {activity: count}, {pc: count})."""
+    samples, lost, act, pcs = 0, 0, {}, {}
+    for payload in packets(data, max_payload):
+        if len(payload) < 2 or payload[0] != PROF_TAG:
+            continue
+        rtype = payload[1]
+        if rtype == PROF_REC_SUMMARY and len(payload) == 10:
+            # a new dump starts
+            samples, lost = struct.unpack('>II', payload[2:])
+            act, pcs = {}, {}
+        elif rtype == PROF_REC_ACT and len(payload) == 7:
+            act[payload[2]] = struct.unpack('>I', payload[3:])[0]
+        elif rtype == PROF_REC_PC and len(payload) == 10:
+            pc, count = struct.unpack('>II', payload[2:])
+            pcs[pc] = pcs.get(pc, 0) + count
+    return samples, lost, act, pcs
+
+
+def load_symbols(elf, nm):
+    """Return the sorted function symbols as (addresses, [(addr, size, name)])."""
+    out = subprocess.run([nm, '-S', '-n', '-C', '--defined-only', elf],
+                         check=True, capture_output=True, text=True).stdout
+    syms = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) == 4 and parts[2] in 'tTwW':
+            syms.append((int(parts[0], 16), int(parts[1], 16), parts[3]))
+        elif len(parts) == 3 and parts[1] in 'tTwW':
+            syms.append((int(parts[0], 16), 0, parts[2]))
+    return [s[0] for s in syms], syms
+
+
+def function_of(pc, addrs, syms):
+    """Name of the function containing the address, '?' if none."""
+    i = bisect.bisect_right(addrs, pc) - 1
+    if i < 0:
+        return '?'
+    addr, size, name = syms[i]
+    if size and pc >= addr + size:
+        return '?'
+    return name
+
+
+def source_lines(pcs, elf, addr2line):
+    """Map each address to 'file:line' using addr2line."""
+    if not pcs:
+        return {}
+    out = subprocess.run([addr2line, '-e', elf] + ['%x' % pc for pc in pcs],
+                         check=True, capture_output=True, text=True).stdout
+    return dict(zip(pcs, out.splitlines()))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('capture', help='raw serial capture file')
+    parser.add_argument('elf', help='ELF file of the firmware or program')
+    parser.add_argument('--prefix', default='',
+                        help='binutils prefix, e.g. arm-none-eabi-')
+    parser.add_argument('--lines', action='store_true',
+                        help='break down by source line')
+    parser.add_argument('--json', action='store_true', help='JSON output')
+    parser.add_argument('--max-payload', type=int, default=10,
+                        help='MAX_PAYLOAD of the target')
+    args = parser.parse_args()
+
+    with open(args.capture, 'rb') as f:
+        data = f.read()
+
+    samples, lost, act, pcs = histogram(data, args.max_payload)
+    addrs, syms = load_symbols(args.elf, args.prefix + 'nm')
+
+    # the thumb bit is not part of the address
+    hits = {}
+    lines = {}
+    if args.lines:
+        lines = source_lines(sorted({pc & ~1 for pc in pcs}), args.elf,
+                             args.prefix + 'addr2line')
+    for pc, count in pcs.items():
+        addr = pc & ~1
+        key = function_of(addr, addrs, syms)
+        if args.lines:
+            key = '%s %s' % (key, lines.get(addr, '?'))
+        hits[key] = hits.get(key, 0) + count
+
+    attributed = sum(pcs.values())
+    rows = sorted(hits.items(), key=lambda x: -x[1])
+    total = samples if samples else 1
+
+    if args.json:
+        json.dump({'samples': samples, 'lost': lost,
+                   'unattributed': samples - attributed - lost,
+                   'activities': {str(a): c for a, c in sorted(act.items())},
+                   'symbols': [{'name': k, 'count': c} for k, c in rows]},
+                  sys.stdout, indent=2)
+        print()
+        return
+
+    print('samples %d, lost %d, without pc %d' %
+          (samples, lost, samples - attributed - lost))
+    print('\nactivity   count      %')
+    for a, c in sorted(act.items()):
+        print('%8s %7d %6.1f' % (ACT_NAMES.get(a, a), c, 100.0 * c / total))
+    print('\n  count      %  symbol')
+    for key, c in rows:
+        print('%7d %6.1f  %s' % (c, 100.0 * c / total, key))
+
+
+if __name__ == '__main__':
+    main()
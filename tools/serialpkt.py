@@ -0,0 +1,33 @@
+"""
+Packets of SerialComm in a raw byte stream captured from the serial port,
+shared by the tools that read the dumps of the utilities.
+
+    (PKT_HEADR)(size)(payload:size)(XOR checksum of the payload)
+
+Bytes outside a valid packet, such as the control bytes and the frames
+broken by a lost byte, are skipped.
+"""
+
+PKT_HEADR = 0xf5
+
+
+def packets(data, max_payload):
+    """Yield the payload of each valid packet in the stream."""
+    i = 0
+    while i + 2 < len(data):
+        if data[i] != PKT_HEADR or data[i + 1] > max_payload:
+            i += 1
+            continue
+        size = data[i + 1]
+        end = i + 2 + size
+        if end >= len(data):
+            break
+        payload = data[i + 2:end]
+        csum = 0
+        for b in payload:
+            csum ^= b
+        if csum == data[end]:
+            yield payload
+            i = end + 1
+        else:
+            i += 1
@@ -0,0 +1,107 @@
+"""
+Convert the trace records dumped by Trace_Dump() into Chrome trace JSON,
+which can be opened by chrome://tracing or https://ui.perfetto.dev
+
+The input is the raw byte stream captured from the serial port. Packets
+other than the trace records are skipped.
+
+    python3 trace2json.py capture.bin -o trace.json
+    python3 trace2json.py capture.bin --tick-us 0.0139    # 72MHz cycle count
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+from serialpkt import packets
+
+TRACE_TAG = 0xfa
+
+TRC_TMR_BEGIN = 1
+TRC_TMR_END = 2
+TRC_EVT_ENQ = 3
+TRC_EVT_DROP = 4
+TRC_EVT_DEQ = 5
+TRC_PKT = 6
+
+PKT_STATUS = ['INPROCES', 'PKT_RECEIVED', 'ACK_RECEIVED', 'NAK_RECEIVED',
+              'IAM_RECEIVED', 'PKT_SIZE_ERR', 'PKT_CSUM_ERR', 'PKT_DROPPED',
+              'XOFF_RECEIVED', 'XON_RECEIVED']
+
+
+def records(data, max_payload):
+    """Yield (time, type, arg0, arg1) with the time unwrapped to 64 bits."""
+    last = None
+    high = 0
+    for payload in packets(data, max_payload):
+        if len(payload) != 9 or payload[0] != TRACE_TAG:
+            continue
+        time, rtype, arg0, arg1 = struct.unpack('>IBBH', payload[1:])
+        if last is not None and time < last:
+            high += 1 << 32
+        last = time
+        yield high + time, rtype, arg0, arg1
+
+
+def convert(recs, tick_us):
+    events = []
+    for time, rtype, arg0, arg1 in recs:
+        ts = time * tick_us
+        if rtype == TRC_TMR_BEGIN or rtype == TRC_TMR_END:
+            events.append({'name': 'timer %d' % arg0, 'cat': 'UsrTimer',
+                           'ph': 'B' if rtype == TRC_TMR_BEGIN else 'E',
+                           'ts': ts, 'pid': 1, 'tid': 1})
+        elif rtype == TRC_EVT_ENQ or rtype == TRC_EVT_DEQ:
+            events.append({'name': 'Evt_EnQueue' if rtype == TRC_EVT_ENQ
+                           else 'Evt_DeQueue', 'cat': 'EvtQueue', 'ph': 'i',
+                           's': 't', 'ts': ts, 'pid': 1, 'tid': 2,
+                           'args': {'code': arg0}})
+            events.append({'name': 'evt_queue', 'ph': 'C', 'ts': ts,
+                           'pid': 1, 'args': {'count': arg1}})
+        elif rtype == TRC_EVT_DROP:
+            events.append({'name': 'event lost', 'cat': 'EvtQueue',
+                           'ph': 'i', 's': 'p', 'ts': ts, 'pid': 1, 'tid': 2,
+                           'args': {'code': arg0}})
+        elif rtype == TRC_PKT:
+            status = PKT_STATUS[arg0] if arg0 < len(PKT_STATUS) else arg0
+            events.append({'name': str(status), 'cat': 'SerialComm',
+                           'ph': 'i', 's': 't', 'ts': ts, 'pid': 1, 'tid': 3,
+                           'args': {'size': arg1}})
+        else:
+            events.append({'name': 'user %d' % rtype, 'cat': 'user',
+                           'ph': 'i', 's': 't', 'ts': ts, 'pid': 1, 'tid': 4,
+                           'args': {'arg0': arg0, 'arg1': arg1}})
+
+    names = {1: 'UsrTimer', 2: 'EvtQueue', 3: 'SerialComm', 4: 'user'}
+    for tid, name in names.items():
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': 1,
+                       'tid': tid, 'args': {'name': name}})
+
+    return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('capture', help='raw serial capture file')
+    parser.add_argument('-o', '--output', help='output file (stdout)')
+    parser.add_argument('--tick-us', type=float, default=1000.0,
+                        help='usec per timestamp unit (1000: HAL_GetTick)')
+    parser.add_argument('--max-payload', type=int, default=10,
+                        help='MAX_PAYLOAD of the target')
+    args = parser.parse_args()
+
+    with open(args.capture, 'rb') as f:
+        data = f.read()
+
+    trace = convert(records(data, args.max_payload), args.tick_us)
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()